@@ -0,0 +1,85 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "../include/compression.h"
+
+// The LZ4 block codec behind FRAME_FLAG_LZ4: ratio and throughput on the
+// kinds of data the server carries (chat text, logs, JSON, CSV, and
+// already-compressed/random bytes), at a chat-message size and at the
+// file chunk size.
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string make_data(const std::string& kind, size_t len) {
+    std::string out;
+    srand(5);
+    const char* words[] = {"the", "build", "is", "green", "deploy", "after", "lunch", "review", "my", "patch",
+                           "server", "latency", "looks", "fine", "now", "ok", "thanks", "merged"};
+    for (int i = 0; out.size() < len; ++i) {
+        if (kind == "chat") {
+            out += words[rand() % 18];
+            out += (rand() % 9 == 0) ? ". " : " ";
+        } else if (kind == "log") {
+            out += "2026-10-17 09:" + std::to_string(10 + i / 600 % 50) + ":" + std::to_string(10 + i / 10 % 50) +
+                   " [INFO] File transfer complete: report_" + std::to_string(rand() % 40) + ".csv (fd: " +
+                   std::to_string(rand() % 900 + 12) + ")\n";
+        } else if (kind == "json") {
+            out += "{\"id\":" + std::to_string(100000 + i) + ",\"user\":\"user" + std::to_string(rand() % 500) +
+                   "\",\"status\":\"" + (rand() % 4 ? "ok" : "failed") + "\",\"bytes\":" +
+                   std::to_string(rand() % 1000000) + "},\n";
+        } else if (kind == "csv") {
+            out += std::to_string(i) + "," + std::to_string(rand() % 100) + "." + std::to_string(rand() % 100) +
+                   "," + words[rand() % 18] + "," + std::to_string(1700000000 + i * 60) + "\n";
+        } else {
+            out += (char)rand();
+        }
+    }
+    out.resize(len);
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    size_t total = (argc > 1 ? std::stoul(argv[1]) : 256) * 1024 * 1024;  // MB processed per cell
+
+    std::cout << "[Bench] LZ4 block codec, " << total / (1024 * 1024) << " MB per cell" << std::endl;
+    std::cout << std::setw(8) << "data" << std::setw(10) << "bytes" << std::setw(9) << "ratio"
+              << std::setw(14) << "comp MB/s" << std::setw(14) << "decomp MB/s" << std::endl;
+    std::cout << std::fixed;
+    for (const char* kind : {"chat", "log", "json", "csv", "random"}) {
+        for (size_t len : {2048, 128 * 1024}) {
+            std::string data = make_data(kind, len);
+            std::vector<char> packed(lz4_compress_bound(len));
+            std::string out(len, '\0');
+            size_t rounds = std::max<size_t>(1, total / len);
+
+            size_t n = 0;
+            int64_t start = now_ns();
+            for (size_t i = 0; i < rounds; ++i) n = lz4_compress(data.data(), len, packed.data(), packed.size());
+            double comp = (double)rounds * len * 1e3 / (now_ns() - start);
+
+            start = now_ns();
+            for (size_t i = 0; i < rounds; ++i) {
+                if (!lz4_decompress(packed.data(), n, &out[0], len)) {
+                    std::cerr << "round trip failed for " << kind << std::endl;
+                    return 1;
+                }
+            }
+            double decomp = (double)rounds * len * 1e3 / (now_ns() - start);
+            if (out != data) {
+                std::cerr << "round trip mismatch for " << kind << std::endl;
+                return 1;
+            }
+
+            std::cout << std::setw(8) << kind << std::setw(10) << len << std::setprecision(2) << std::setw(9)
+                      << (double)len / n << std::setprecision(0) << std::setw(14) << comp << std::setw(14)
+                      << decomp << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "../include/protocol.h"
+
+// Connect storm against a running server: every client connects at once,
+// as after a deploy, and logs in. A connection counts as accepted when its
+// MSG_LOGIN_ACK arrives, i.e. the server accepted it, registered it and
+// answered it. Reports accepts/s over the whole storm plus the connect ->
+// ACK latency; SYNs dropped on a full listen queue show up as latencies
+// past 1 s (the client's first SYN retransmit).
+//
+//   ./bin/server --listen-backlog=4096 --edge-triggered=on &
+//   ./bin/bench_connect_storm 8080 20000 4
+//
+// Both processes need an open file limit above the connection count
+// (ulimit -n); this one raises its own soft limit to the hard limit.
+
+static const int kTimeoutSec = 30;
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Client {
+    int fd = -1;
+    bool connected = false;
+    int64_t started = 0;
+    int64_t connected_at = 0;
+    int64_t acked_at = 0;
+    size_t received = 0;
+    char reply[sizeof(PacketHeader) + 64];
+};
+
+struct Totals {
+    std::atomic<int> acked{0};
+    std::atomic<int> failed{0};
+    std::atomic<int64_t> last_ack{0};
+};
+
+static void send_login(Client& c, const std::string& name) {
+    char packet[sizeof(PacketHeader) + sizeof(LoginBody)];
+    memset(packet, 0, sizeof(packet));
+    PacketHeader* header = reinterpret_cast<PacketHeader*>(packet);
+    header->total_len = sizeof(packet);
+    header->msg_type = MSG_LOGIN;
+    strncpy(packet + sizeof(PacketHeader), name.c_str(), sizeof(LoginBody) - 1);
+    // Tiny write into an empty socket buffer: it goes out whole
+    if (::send(c.fd, packet, sizeof(packet), MSG_NOSIGNAL) != (ssize_t)sizeof(packet)) {
+        close(c.fd);
+        c.fd = -1;
+    }
+}
+
+// True once the whole MSG_LOGIN_ACK frame is in; any other reply fails the client
+static bool read_ack(Client& c) {
+    for (;;) {
+        ssize_t n = recv(c.fd, c.reply + c.received, sizeof(c.reply) - c.received, 0);
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+            close(c.fd);
+            c.fd = -1;
+            return false;
+        }
+        c.received += n;
+        if (c.received < sizeof(PacketHeader)) continue;
+        const PacketHeader* header = reinterpret_cast<const PacketHeader*>(c.reply);
+        size_t want = std::min<size_t>(header->total_len, sizeof(c.reply));
+        if (c.received < want) continue;
+        if ((header->msg_type & kMsgTypeMask) == MSG_LOGIN_ACK) return true;
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+}
+
+static void storm(int thread_id, const sockaddr_in& addr, int count, std::vector<Client>& clients,
+                  Totals& totals, int64_t deadline) {
+    int ep = epoll_create1(0);
+    for (int i = 0; i < count; ++i) {
+        Client& c = clients[i];
+        c.started = now_ns();
+        c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (c.fd < 0 || (connect(c.fd, (const sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)) {
+            if (c.fd >= 0) close(c.fd);
+            c.fd = -1;
+            totals.failed++;
+            continue;
+        }
+        epoll_event ev;
+        ev.events = EPOLLOUT | EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    int pending = 0;
+    for (const Client& c : clients) pending += c.fd >= 0;
+    std::vector<epoll_event> events(1024);
+    while (pending > 0 && now_ns() < deadline) {
+        int n = epoll_wait(ep, events.data(), (int)events.size(), 100);
+        for (int e = 0; e < n; ++e) {
+            Client& c = clients[events[e].data.u32];
+            if (c.fd < 0 || c.acked_at) continue;
+            if (!c.connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err == 0) {
+                    c.connected = true;
+                    c.connected_at = now_ns();
+                    send_login(c, "storm-" + std::to_string(thread_id) + "-" + std::to_string(events[e].data.u32));
+                    if (c.fd >= 0) {
+                        epoll_event ev;
+                        ev.events = EPOLLIN;
+                        ev.data.u32 = events[e].data.u32;
+                        epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+                    }
+                } else {
+                    close(c.fd);
+                    c.fd = -1;
+                }
+            } else if (read_ack(c)) {
+                c.acked_at = now_ns();
+                totals.acked++;
+                int64_t last = totals.last_ack.load();
+                while (c.acked_at > last && !totals.last_ack.compare_exchange_weak(last, c.acked_at)) {}
+                pending--;
+                continue;
+            }
+            if (c.fd < 0) {
+                totals.failed++;
+                pending--;
+            }
+        }
+    }
+    close(ep);
+}
+
+static double percentile_ms(const std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * p))] / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    int port = argc > 1 ? std::stoi(argv[1]) : 8080;
+    int connections = argc > 2 ? std::stoi(argv[2]) : 10000;
+    int threads = argc > 3 ? std::stoi(argv[3]) : 4;
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    std::vector<std::vector<Client>> clients(threads);
+    for (int t = 0; t < threads; ++t) {
+        clients[t].resize(connections / threads + (t < connections % threads ? 1 : 0));
+    }
+
+    std::cout << "[Bench] Connect storm, " << connections << " clients on " << threads
+              << " threads -> 127.0.0.1:" << port << ", latency = connect -> MSG_LOGIN_ACK" << std::endl;
+    Totals totals;
+    int64_t start = now_ns();
+    int64_t deadline = start + kTimeoutSec * 1000000000LL;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(storm, t, std::cref(addr), (int)clients[t].size(), std::ref(clients[t]),
+                             std::ref(totals), deadline);
+    }
+    for (auto& w : workers) w.join();
+
+    std::vector<int64_t> connect_lat, ack_lat;
+    int slow = 0;
+    for (const auto& group : clients) {
+        for (const Client& c : group) {
+            if (c.connected_at) connect_lat.push_back(c.connected_at - c.started);
+            if (c.acked_at) {
+                ack_lat.push_back(c.acked_at - c.started);
+                if (c.acked_at - c.started > 1000000000LL) slow++;
+            }
+            if (c.fd >= 0) close(c.fd);
+        }
+    }
+    std::sort(connect_lat.begin(), connect_lat.end());
+    std::sort(ack_lat.begin(), ack_lat.end());
+
+    int acked = totals.acked.load();
+    double secs = acked ? (totals.last_ack.load() - start) / 1e9 : 0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "accepted " << acked << "/" << connections << " (" << totals.failed.load() << " failed, "
+              << (connections - acked - totals.failed.load()) << " timed out) in " << std::setprecision(3)
+              << secs << " s: " << std::setprecision(0) << (secs > 0 ? acked / secs : 0) << " accepts/s"
+              << std::endl;
+    std::cout << std::setprecision(1);
+    std::cout << std::setw(12) << "" << std::setw(11) << "p50 ms" << std::setw(11) << "p99 ms"
+              << std::setw(11) << "max ms" << std::endl;
+    std::cout << std::setw(12) << "connect" << std::setw(11) << percentile_ms(connect_lat, 0.5)
+              << std::setw(11) << percentile_ms(connect_lat, 0.99) << std::setw(11)
+              << percentile_ms(connect_lat, 1.0) << std::endl;
+    std::cout << std::setw(12) << "login ack" << std::setw(11) << percentile_ms(ack_lat, 0.5)
+              << std::setw(11) << percentile_ms(ack_lat, 0.99) << std::setw(11)
+              << percentile_ms(ack_lat, 1.0) << std::endl;
+    std::cout << slow << " login(s) took over 1 s (SYN retransmits: listen queue overflow)" << std::endl;
+    return acked == connections ? 0 : 1;
+}
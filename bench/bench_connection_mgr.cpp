@@ -0,0 +1,137 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include "../include/connection_mgr.h"
+
+// Contention benchmark: sharded ConnectionMgr vs. the previous registry
+// (one std::mutex around a std::map plus the username index).
+// Each worker runs the server's access mix against a pre-populated registry:
+//   94% get_user_by_fd (every packet), 4% get_user_by_username (DMs),
+//    1% full scan (broadcast),           1% disconnect + reconnect + login.
+
+class LegacyConnectionMgr {
+public:
+    std::shared_ptr<UserContext> add_connection(int fd) {
+        std::lock_guard<std::mutex> lock(map_mutex);
+        auto user = std::make_shared<UserContext>(fd);
+        connections[fd] = user;
+        return user;
+    }
+
+    void remove_connection(int fd) {
+        std::lock_guard<std::mutex> lock(map_mutex);
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        auto name = by_username.find(it->second->username);
+        if (name != by_username.end() && name->second == it->second) by_username.erase(name);
+        connections.erase(it);
+    }
+
+    bool bind_username(const std::shared_ptr<UserContext>& user, const std::string& username,
+                       std::shared_ptr<UserContext>& displaced) {
+        std::lock_guard<std::mutex> lock(map_mutex);
+        auto it = by_username.find(username);
+        if (it != by_username.end() && it->second != user) {
+            displaced = it->second;
+            by_username.erase(it);
+        }
+        user->username = username;
+        by_username[username] = user;
+        return true;
+    }
+
+    std::shared_ptr<UserContext> get_user_by_fd(int fd) {
+        std::lock_guard<std::mutex> lock(map_mutex);
+        auto it = connections.find(fd);
+        return it != connections.end() ? it->second : nullptr;
+    }
+
+    std::shared_ptr<UserContext> get_user_by_username(const std::string& username) {
+        std::lock_guard<std::mutex> lock(map_mutex);
+        auto it = by_username.find(username);
+        return it != by_username.end() ? it->second : nullptr;
+    }
+
+    size_t scan() {
+        std::lock_guard<std::mutex> lock(map_mutex);
+        std::vector<std::shared_ptr<UserContext>> users;
+        users.reserve(connections.size());
+        for (const auto& kv : connections) users.push_back(kv.second);
+        return users.size();
+    }
+
+private:
+    std::map<int, std::shared_ptr<UserContext>> connections;
+    std::unordered_map<std::string, std::shared_ptr<UserContext>> by_username;
+    std::mutex map_mutex;
+};
+
+static size_t scan(LegacyConnectionMgr& mgr) { return mgr.scan(); }
+static size_t scan(ConnectionMgr& mgr) { return mgr.get_all_users()->size(); }
+
+template <class Registry>
+double run(int threads, int users, int ops_per_thread) {
+    Registry mgr;
+    std::vector<std::string> names(users);
+    for (int i = 0; i < users; ++i) {
+        names[i] = "user" + std::to_string(i);
+        std::shared_ptr<UserContext> displaced;
+        mgr.bind_username(mgr.add_connection(i), names[i], displaced);
+    }
+
+    std::atomic<size_t> sink(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(t + 1);
+            size_t local = 0;
+            while (!go.load()) {}
+            for (int i = 0; i < ops_per_thread; ++i) {
+                int fd = rng() % users;
+                int op = rng() % 100;
+                if (op < 94) {
+                    local += mgr.get_user_by_fd(fd) != nullptr;
+                } else if (op < 98) {
+                    local += mgr.get_user_by_username(names[fd]) != nullptr;
+                } else if (op < 99) {
+                    local += scan(mgr);
+                } else {
+                    mgr.remove_connection(fd);
+                    std::shared_ptr<UserContext> displaced;
+                    mgr.bind_username(mgr.add_connection(fd), names[fd], displaced);
+                }
+            }
+            sink += local;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& w : workers) w.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)threads * ops_per_thread / secs;
+}
+
+int main(int argc, char* argv[]) {
+    int users = argc > 1 ? std::stoi(argv[1]) : 10000;
+    int ops = argc > 2 ? std::stoi(argv[2]) : 200000;
+
+    std::cout << "[Bench] ConnectionMgr contention, " << users << " users, "
+              << ops << " ops/thread" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "legacy ops/s"
+              << std::setw(16) << "sharded ops/s" << std::setw(10) << "speedup" << std::endl;
+    for (int threads : {4, 8, 16}) {
+        double legacy = run<LegacyConnectionMgr>(threads, users, ops);
+        double sharded = run<ConnectionMgr>(threads, users, ops);
+        std::cout << std::setw(8) << threads << std::setw(16) << (long long)legacy
+                  << std::setw(16) << (long long)sharded << std::setw(9) << std::fixed
+                  << std::setprecision(2) << sharded / legacy << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cstdlib>
+#include <new>
+#include "../include/threadpool.h"
+#include "../include/serial_executor.h"
+
+// Heap allocations per task on the ThreadPool submission paths.
+// Global operator new is replaced with a counting hook; each path submits
+// bursts of tasks whose captures mimic a packet dispatch (a shared_ptr, a
+// header and a body view, ~64 bytes) and waits for them to finish. The
+// fire-and-forget paths (post, SerialExecutor::post) must show zero.
+
+static std::atomic<size_t> g_allocs(0);
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct FakePacket {
+    std::shared_ptr<int> user;
+    char header[16];
+    const char* body;
+    size_t body_len;
+    void* server;
+};
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+    double allocs_per_task;
+    double ns_per_task;
+};
+
+// submit(task) is called burst times per round; every task bumps done
+template <class Submit>
+Result measure(int rounds, int burst, Submit submit) {
+    std::atomic<size_t> done(0);
+    auto user = std::make_shared<int>(42);
+    auto run_round = [&](size_t target) {
+        for (int i = 0; i < burst; ++i) {
+            FakePacket packet{user, {0}, nullptr, (size_t)i, nullptr};
+            submit([packet, &done]() {
+                (void)packet;
+                done.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        while (done.load(std::memory_order_acquire) < target) std::this_thread::yield();
+    };
+
+    // Warm-up: thread-locals, executor ring growth
+    size_t target = burst;
+    run_round(target);
+
+    size_t before = g_allocs.load();
+    int64_t start = now_ns();
+    for (int r = 0; r < rounds; ++r) {
+        target += burst;
+        run_round(target);
+    }
+    int64_t elapsed = now_ns() - start;
+    size_t allocs = g_allocs.load() - before;
+
+    size_t total = (size_t)rounds * burst;
+    return Result{(double)allocs / total, (double)elapsed / total};
+}
+
+static void print(const char* name, const Result& r) {
+    std::cout << std::setw(22) << name << std::fixed << std::setprecision(3)
+              << std::setw(14) << r.allocs_per_task << std::setprecision(1)
+              << std::setw(12) << r.ns_per_task << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int workers = argc > 1 ? std::stoi(argv[1]) : 4;
+    int rounds = argc > 2 ? std::stoi(argv[2]) : 200;
+    const int burst = 1000;  // Stays within the rings: the overflow deque is not measured
+
+    std::cout << "[Bench] Allocations per task, " << workers << " workers, "
+              << rounds << " x " << burst << " tasks" << std::endl;
+    std::cout << std::setw(22) << "path" << std::setw(14) << "allocs/task" << std::setw(12) << "ns/task" << std::endl;
+
+    ThreadPool pool(workers);
+    Result enqueue = measure(rounds, burst, [&](auto&& task) { pool.enqueue(std::move(task)); });
+    Result post = measure(rounds, burst, [&](auto&& task) { pool.post(std::move(task)); });
+    auto strand = std::make_shared<SerialExecutor>(&pool);
+    Result serial = measure(rounds, burst, [&](auto&& task) { strand->post(std::move(task)); });
+
+    print("ThreadPool::enqueue", enqueue);
+    print("ThreadPool::post", post);
+    print("SerialExecutor::post", serial);
+
+    if (post.allocs_per_task != 0 || serial.allocs_per_task != 0) {
+        std::cout << "[Bench] FAIL: fire-and-forget path allocated" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "../include/threadpool.h"
+
+// Throughput and queueing latency: work-stealing ThreadPool vs. the previous
+// pool (one std::queue behind one mutex/condition variable).
+// P producer threads each submit N empty tasks; every task records the time
+// from enqueue to the moment a worker starts it.
+
+class LegacyThreadPool {
+public:
+    LegacyThreadPool(size_t threads) : stop(false) {
+        for(size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this] {
+                for(;;) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(this->queue_mutex);
+                        this->condition.wait(lock, [this]{ return this->stop || !this->tasks.empty(); });
+                        if(this->stop && this->tasks.empty())
+                            return;
+                        task = std::move(this->tasks.front());
+                        this->tasks.pop();
+                    }
+                    task();
+                }
+            });
+    }
+
+    ~LegacyThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            stop = true;
+        }
+        condition.notify_all();
+        for(std::thread &worker: workers)
+            worker.join();
+    }
+
+    template<class F>
+    std::future<void> enqueue(F&& f) {
+        auto task = std::make_shared<std::packaged_task<void()>>(std::forward<F>(f));
+        std::future<void> res = task->get_future();
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            tasks.emplace([task](){ (*task)(); });
+        }
+        condition.notify_one();
+        return res;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable condition;
+    bool stop;
+};
+
+struct Result {
+    double tasks_per_sec;
+    double p50_us, p99_us, p999_us;
+};
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <class Pool>
+Result run(int workers, int producers, int tasks_per_producer) {
+    size_t total = (size_t)producers * tasks_per_producer;
+    std::vector<int64_t> latency(total);
+    std::atomic<size_t> done(0);
+
+    int64_t start = now_ns();
+    {
+        Pool pool(workers);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                for (int i = 0; i < tasks_per_producer; ++i) {
+                    size_t slot = (size_t)p * tasks_per_producer + i;
+                    int64_t enqueued = now_ns();
+                    pool.enqueue([&latency, &done, slot, enqueued] {
+                        latency[slot] = now_ns() - enqueued;
+                        done.fetch_add(1, std::memory_order_relaxed);
+                    });
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        while (done.load() < total) std::this_thread::yield();
+    }
+    double secs = (now_ns() - start) / 1e9;
+
+    std::sort(latency.begin(), latency.end());
+    Result r;
+    r.tasks_per_sec = total / secs;
+    r.p50_us = latency[total / 2] / 1e3;
+    r.p99_us = latency[total * 99 / 100] / 1e3;
+    r.p999_us = latency[total * 999 / 1000] / 1e3;
+    return r;
+}
+
+static void print(const char* name, int producers, const Result& r) {
+    std::cout << std::setw(8) << name << std::setw(11) << producers
+              << std::setw(14) << (long long)r.tasks_per_sec << std::fixed << std::setprecision(1)
+              << std::setw(11) << r.p50_us << std::setw(11) << r.p99_us
+              << std::setw(11) << r.p999_us << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int workers = argc > 1 ? std::stoi(argv[1]) : 4;
+    int tasks = argc > 2 ? std::stoi(argv[2]) : 200000;
+
+    std::cout << "[Bench] ThreadPool, " << workers << " workers, " << tasks
+              << " tasks/producer, latency = enqueue -> task start" << std::endl;
+    std::cout << std::setw(8) << "pool" << std::setw(11) << "producers" << std::setw(14) << "tasks/s"
+              << std::setw(11) << "p50 us" << std::setw(11) << "p99 us" << std::setw(11) << "p999 us" << std::endl;
+    for (int producers : {1, 4}) {
+        print("legacy", producers, run<LegacyThreadPool>(workers, producers, tasks));
+        print("stealing", producers, run<ThreadPool>(workers, producers, tasks));
+    }
+    return 0;
+}
@@ -0,0 +1,571 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "../include/protocol.h"
+#include "../include/compression.h"
+#include "../include/histogram.h"
+
+// Headless load generator (make bench). Opens many logged-in connections
+// from one process, a few epoll threads, and drives a weighted mix of
+// public chat, private chat, heartbeats and file requests at a target
+// aggregate rate against a server on this host. Every chat message carries
+// its send time (steady clock, shared by both processes on one machine), so
+// each delivery gives an end-to-end latency; file requests are timed to
+// their MSG_FILE_END.
+//
+//   ./bin/server --reactors=4 --listen-backlog=4096 &
+//   ./bin/load_generator --connections=20000 --rate=20000 --duration=30
+//       --mix=public:1,private:90,heartbeat:9 --size=128
+//
+// A public message is delivered to every other connection: its weight
+// multiplies the server's output by the connection count. File requests
+// need --file=<name in file_storage>. More than ~28000 connections are
+// spread over several loopback source addresses (127.0.0.x).
+
+enum Kind { kPublic, kPrivate, kHeartbeat, kFile, kKinds };
+static const char* const kKindNames[kKinds] = {"public", "private", "heartbeat", "file"};
+
+static const int kConnectTimeoutSec = 60;
+static const int kKeepaliveSec = 10;             // Heartbeat on every connection, besides the mix
+static const int kConnectionsPerSource = 20000;  // Per loopback source address
+static const char kStamp[] = "#lg ";             // Precedes the send time in chat content
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 1000;
+    int threads = 4;
+    double rate = 5000;      // Messages per second, all connections together
+    int duration = 10;       // Seconds of traffic
+    int drain = 2;           // Seconds to wait for deliveries after the last send
+    int size = 64;           // Bytes of chat content
+    int connect_batch = 256; // Connects in flight per thread
+    bool lz4 = false;        // Ask for FEATURE_LZ4
+    std::string file;
+    uint64_t file_bytes = 64 * 1024;
+    int weights[kKinds] = {1, 90, 9, 0};
+};
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool parse_mix(const std::string& value, int* weights) {
+    int parsed[kKinds] = {0, 0, 0, 0};
+    std::stringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) return false;
+        std::string name = item.substr(0, colon);
+        int kind = std::find(kKindNames, kKindNames + kKinds, name) - kKindNames;
+        if (kind == kKinds) return false;
+        parsed[kind] = std::stoi(item.substr(colon + 1));
+        if (parsed[kind] < 0) return false;
+    }
+    std::copy(parsed, parsed + kKinds, weights);
+    return true;
+}
+
+static bool parse_options(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) return false;
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        try {
+            if (key == "host") opt.host = value;
+            else if (key == "port") opt.port = std::stoi(value);
+            else if (key == "connections") opt.connections = std::stoi(value);
+            else if (key == "threads") opt.threads = std::stoi(value);
+            else if (key == "rate") opt.rate = std::stod(value);
+            else if (key == "duration") opt.duration = std::stoi(value);
+            else if (key == "drain") opt.drain = std::stoi(value);
+            else if (key == "size") opt.size = std::stoi(value);
+            else if (key == "connect-batch") opt.connect_batch = std::stoi(value);
+            else if (key == "lz4") {
+                if (value == "on") opt.lz4 = true;
+                else if (value == "off") opt.lz4 = false;
+                else return false;
+            }
+            else if (key == "file") opt.file = value;
+            else if (key == "file-bytes") opt.file_bytes = std::stoull(value);
+            else if (key == "mix") {
+                if (!parse_mix(value, opt.weights)) return false;
+            }
+            else return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    if (opt.connections < 1 || opt.threads < 1 || opt.threads > opt.connections || opt.size < 0) return false;
+    if (opt.weights[kFile] > 0 && opt.file.empty()) return false;
+    return true;
+}
+
+enum Phase { kConnect, kTraffic, kDrain, kStop };
+
+struct Shared {
+    std::atomic<int> phase{kConnect};
+    std::atomic<int> ready{0};
+    std::atomic<int> failed{0};
+    std::atomic<int64_t> traffic_start{0};
+};
+
+struct Conn {
+    int fd = -1;
+    int id = 0;  // Global index; the user name is "lg<id>"
+    enum State { Connecting, LoggingIn, Ready, Closed } state = Connecting;
+    bool write_armed = false;
+    int64_t started = 0;
+    std::string in;   // Received bytes not yet framed
+    std::string out;  // Queued bytes the socket did not take yet
+    std::deque<int64_t> file_requests;  // Send times of unanswered MSG_FILE_REQ
+};
+
+// One epoll thread and its share of the connections
+class Worker {
+public:
+    Histogram latency[kKinds];  // Delivery (chat) / completion (file) latency, ns; heartbeat unused
+    Histogram login;            // connect() -> MSG_LOGIN_ACK
+    uint64_t sent[kKinds] = {0, 0, 0, 0};
+    uint64_t delivered = 0;
+    uint64_t files_rejected = 0;
+    uint64_t errors = 0;
+    uint64_t disconnects = 0;
+    uint64_t bytes_in = 0;
+
+    Worker(const Options& options, Shared& shared, int index, int first_id, int count)
+        : opt(options), shared(shared), rng(index * 7919 + 1), next_connect(0), connecting(0) {
+        conns.resize(count);
+        for (int i = 0; i < count; ++i) conns[i].id = first_id + i;
+        int total_weight = 0;
+        for (int w : opt.weights) total_weight += w;
+        for (int k = 0; k < kKinds; ++k) {
+            for (int w = 0; w < opt.weights[k]; ++w) kind_table.push_back(k);
+        }
+        if (total_weight == 0) kind_table.push_back(kHeartbeat);
+        rate = opt.rate / opt.threads;
+    }
+
+    void run();
+
+private:
+    const Options& opt;
+    Shared& shared;
+    std::mt19937 rng;
+    std::vector<Conn> conns;
+    std::vector<int> ready;    // Indexes of logged-in connections
+    std::vector<int> kind_table;
+    size_t next_connect;
+    int connecting;
+    int epoll_fd = -1;
+    double rate;
+    uint64_t sent_total = 0;
+
+    void start_connect(size_t index);
+    void on_event(size_t index, uint32_t events);
+    void on_frame(Conn& c, int32_t msg_type, const char* body, size_t len);
+    void queue(Conn& c, int32_t msg_type, const std::string& body);
+    void flush(Conn& c);
+    void set_events(Conn& c, size_t index, bool want_write);
+    void close_conn(Conn& c);
+    void send_one(int64_t now);
+};
+
+void Worker::start_connect(size_t index) {
+    Conn& c = conns[index];
+    c.started = now_ns();
+    connecting++;
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (c.fd >= 0 && opt.host == "127.0.0.1" && c.id >= kConnectionsPerSource) {
+        // Past one address's ephemeral ports: another loopback source.
+        // The port is picked at connect() time, per destination.
+        sockaddr_in src;
+        memset(&src, 0, sizeof(src));
+        src.sin_family = AF_INET;
+        src.sin_addr.s_addr = htonl(0x7F000001 + c.id / kConnectionsPerSource);
+        int one = 1;
+        setsockopt(c.fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+        bind(c.fd, (const sockaddr*)&src, sizeof(src));
+    }
+    if (c.fd < 0 || (connect(c.fd, (const sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)) {
+        close_conn(c);
+        shared.failed++;
+        return;
+    }
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u64 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c.fd, &ev);
+    c.write_armed = true;
+}
+
+void Worker::close_conn(Conn& c) {
+    if (c.fd >= 0) close(c.fd);
+    c.fd = -1;
+    if (c.state == Conn::Connecting || c.state == Conn::LoggingIn) connecting--;
+    else if (c.state == Conn::Ready) disconnects++;
+    c.state = Conn::Closed;
+}
+
+void Worker::set_events(Conn& c, size_t index, bool want_write) {
+    if (c.write_armed == want_write) return;
+    epoll_event ev;
+    ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+    ev.data.u64 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.write_armed = want_write;
+}
+
+void Worker::queue(Conn& c, int32_t msg_type, const std::string& body) {
+    PacketHeader header;
+    header.total_len = sizeof(PacketHeader) + body.size();
+    header.msg_type = msg_type;
+    header.crc32 = 0;  // Not computed: the server never checks it
+    c.out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    c.out.append(body);
+    if (!c.write_armed) flush(c);
+}
+
+void Worker::flush(Conn& c) {
+    size_t done = 0;
+    while (done < c.out.size()) {
+        ssize_t n = ::send(c.fd, c.out.data() + done, c.out.size() - done, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                close_conn(c);
+                return;
+            }
+            break;
+        }
+        done += n;
+    }
+    c.out.erase(0, done);
+    set_events(c, &c - conns.data(), !c.out.empty());
+}
+
+void Worker::on_frame(Conn& c, int32_t msg_type, const char* body, size_t len) {
+    int32_t type = msg_type & kMsgTypeMask;
+    std::vector<char> expanded;
+    if ((msg_type & FRAME_FLAG_LZ4) && type != MSG_LOGIN_ACK) {
+        if (!expand_frame_body(msg_type, body, len, 16 * 1024 * 1024, expanded)) {
+            errors++;
+            return;
+        }
+        body = expanded.data();
+        len = expanded.size();
+    }
+
+    switch (type) {
+        case MSG_LOGIN_ACK:
+            if (c.state == Conn::LoggingIn) {
+                c.state = Conn::Ready;
+                connecting--;
+                login.record(now_ns() - c.started);
+                ready.push_back(&c - conns.data());
+                shared.ready++;
+            }
+            break;
+        case MSG_CHAT_PUBLIC:
+        case MSG_CHAT_PRIVATE: {
+            const char* stamp = (const char*)memmem(body, len, kStamp, sizeof(kStamp) - 1);
+            if (!stamp) break;
+            int64_t sent_at = 0;
+            for (const char* p = stamp + sizeof(kStamp) - 1; p < body + len && *p >= '0' && *p <= '9'; ++p) {
+                sent_at = sent_at * 10 + (*p - '0');
+            }
+            latency[type == MSG_CHAT_PUBLIC ? kPublic : kPrivate].record(std::max<int64_t>(0, now_ns() - sent_at));
+            delivered++;
+            break;
+        }
+        case MSG_FILE_END:
+            if (!c.file_requests.empty()) {
+                latency[kFile].record(now_ns() - c.file_requests.front());
+                c.file_requests.pop_front();
+            }
+            break;
+        case MSG_ERROR: {
+            // A refused or failed download answers its request too
+            std::string text(body, len);
+            bool chat_error = text.compare(0, 14, "User not found") == 0 || text == "Message too long";
+            if (!c.file_requests.empty() && !chat_error) {
+                c.file_requests.pop_front();
+                if (text.find("file transfers") != std::string::npos) {
+                    files_rejected++;
+                    break;
+                }
+            }
+            errors++;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void Worker::on_event(size_t index, uint32_t events) {
+    Conn& c = conns[index];
+    if (c.state == Conn::Closed) return;
+
+    if (c.state == Conn::Connecting) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) return;
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            close_conn(c);
+            shared.failed++;
+            return;
+        }
+        c.state = Conn::LoggingIn;
+        std::string body;
+        LoginBody login_body;
+        memset(&login_body, 0, sizeof(login_body));
+        snprintf(login_body.username, sizeof(login_body.username), "lg%d", c.id);
+        uint32_t features = FEATURE_COMPACT_BODIES | (opt.lz4 ? FEATURE_LZ4 : 0);
+        body.append(reinterpret_cast<const char*>(&login_body), sizeof(login_body));
+        body.append(reinterpret_cast<const char*>(&features), sizeof(features));
+        c.write_armed = true;  // Still registered for EPOLLOUT from the connect
+        c.out.clear();
+        queue(c, MSG_LOGIN, body);
+        flush(c);
+        return;
+    }
+
+    if (events & EPOLLOUT) {
+        flush(c);
+        if (c.state == Conn::Closed) return;
+    }
+    if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP))) return;
+
+    char buf[65536];
+    for (;;) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) {
+            if (c.state == Conn::LoggingIn) shared.failed++;
+            close_conn(c);
+            return;
+        }
+        bytes_in += n;
+        c.in.append(buf, n);
+    }
+
+    size_t pos = 0;
+    while (c.in.size() - pos >= sizeof(PacketHeader)) {
+        PacketHeader header;
+        memcpy(&header, c.in.data() + pos, sizeof(header));
+        if (header.total_len < (int32_t)sizeof(PacketHeader)) {
+            errors++;
+            close_conn(c);
+            return;
+        }
+        if (c.in.size() - pos < (size_t)header.total_len) break;
+        on_frame(c, header.msg_type, c.in.data() + pos + sizeof(PacketHeader),
+                 header.total_len - sizeof(PacketHeader));
+        pos += header.total_len;
+    }
+    c.in.erase(0, pos);
+}
+
+void Worker::send_one(int64_t now) {
+    if (ready.empty()) return;
+    Conn& c = conns[ready[rng() % ready.size()]];
+    if (c.state != Conn::Ready) return;
+    int kind = kind_table[rng() % kind_table.size()];
+
+    if (kind == kPublic || kind == kPrivate) {
+        std::string content = kStamp + std::to_string(now) + " ";
+        if ((int)content.size() < opt.size) content.append(opt.size - content.size(), 'x');
+        std::string target;
+        if (kind == kPrivate) {
+            int peer = rng() % opt.connections;
+            if (peer == c.id) peer = (peer + 1) % opt.connections;
+            target = "lg" + std::to_string(peer);
+        }
+        std::string body;
+        compact_put(body, target);
+        compact_put(body, content);
+        queue(c, (kind == kPublic ? MSG_CHAT_PUBLIC : MSG_CHAT_PRIVATE) | FRAME_FLAG_COMPACT, body);
+    } else if (kind == kHeartbeat) {
+        queue(c, MSG_HEARTBEAT, std::string());
+    } else {
+        FileRangeReqBody req;
+        memset(&req, 0, sizeof(req));
+        strncpy(req.filename, opt.file.c_str(), sizeof(req.filename) - 1);
+        req.offset = 0;
+        req.length = opt.file_bytes;
+        uint32_t features = opt.lz4 ? FEATURE_LZ4 : 0;
+        std::string body(reinterpret_cast<const char*>(&req), sizeof(req));
+        body.append(reinterpret_cast<const char*>(&features), sizeof(features));
+        c.file_requests.push_back(now);
+        queue(c, MSG_FILE_REQ, body);
+    }
+    sent[kind]++;
+}
+
+void Worker::run() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<epoll_event> events(1024);
+    int64_t last_keepalive = now_ns();
+
+    for (;;) {
+        int phase = shared.phase.load();
+        if (phase == kStop) break;
+
+        if (phase == kConnect) {
+            while (connecting < opt.connect_batch && next_connect < conns.size()) start_connect(next_connect++);
+        }
+
+        int n = epoll_wait(epoll_fd, events.data(), (int)events.size(), 1);
+        for (int i = 0; i < n; ++i) on_event(events[i].data.u64, events[i].events);
+
+        int64_t now = now_ns();
+        if (phase == kTraffic) {
+            // Paced against the start: a slow iteration is made up by the next
+            double elapsed = (now - shared.traffic_start.load()) / 1e9;
+            uint64_t due = (uint64_t)(elapsed * rate);
+            while (sent_total < due) {
+                send_one(now);
+                sent_total++;
+            }
+        }
+        if (now - last_keepalive >= kKeepaliveSec * 1000000000LL) {
+            last_keepalive = now;
+            for (int index : ready) {
+                if (conns[index].state == Conn::Ready) queue(conns[index], MSG_HEARTBEAT, std::string());
+            }
+        }
+    }
+    for (Conn& c : conns) {
+        if (c.fd >= 0) close(c.fd);
+    }
+    close(epoll_fd);
+}
+
+static void print_latency(const char* name, const Histogram& h) {
+    std::cout << std::setw(10) << name << std::setw(10) << h.count() << std::setprecision(3)
+              << std::setw(10) << h.percentile(0.5) / 1e6 << std::setw(10) << h.percentile(0.99) / 1e6
+              << std::setw(10) << h.percentile(0.999) / 1e6 << std::setw(10) << h.max() / 1e6 << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parse_options(argc, argv, opt)) {
+        std::cerr << "Usage: " << argv[0] << " [--host=127.0.0.1] [--port=8080] [--connections=1000]"
+                  << " [--threads=4] [--rate=msgs/s] [--duration=s] [--drain=s] [--size=bytes]"
+                  << " [--mix=public:1,private:90,heartbeat:9,file:0] [--file=name] [--file-bytes=65536]"
+                  << " [--lz4=on|off] [--connect-batch=256]" << std::endl;
+        return 1;
+    }
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    std::cout << "[Bench] Load: " << opt.connections << " connections on " << opt.threads << " threads -> "
+              << opt.host << ":" << opt.port << ", " << opt.rate << " msg/s for " << opt.duration << " s (";
+    for (int k = 0; k < kKinds; ++k) std::cout << (k ? ", " : "") << kKindNames[k] << " " << opt.weights[k];
+    std::cout << "), " << opt.size << "-byte messages" << (opt.lz4 ? ", lz4" : "") << std::endl;
+
+    Shared shared;
+    std::vector<std::unique_ptr<Worker>> workers;
+    int first = 0;
+    for (int t = 0; t < opt.threads; ++t) {
+        int count = opt.connections / opt.threads + (t < opt.connections % opt.threads ? 1 : 0);
+        workers.emplace_back(new Worker(opt, shared, t, first, count));
+        first += count;
+    }
+    std::vector<std::thread> threads;
+    int64_t start = now_ns();
+    for (auto& w : workers) threads.emplace_back(&Worker::run, w.get());
+
+    // Traffic starts once every connection is logged in (or gave up)
+    int64_t deadline = start + kConnectTimeoutSec * 1000000000LL;
+    while (shared.ready.load() + shared.failed.load() < opt.connections && now_ns() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double login_secs = (now_ns() - start) / 1e9;
+    int ready = shared.ready.load();
+
+    int64_t traffic_start = now_ns();
+    shared.traffic_start = traffic_start;
+    shared.phase = kTraffic;
+    std::this_thread::sleep_for(std::chrono::seconds(opt.duration));
+    double traffic_secs = (now_ns() - traffic_start) / 1e9;
+    shared.phase = kDrain;
+    std::this_thread::sleep_for(std::chrono::seconds(opt.drain));
+    shared.phase = kStop;
+    for (auto& t : threads) t.join();
+
+    Histogram latency[kKinds];
+    Histogram login;
+    uint64_t sent[kKinds] = {0, 0, 0, 0};
+    uint64_t delivered = 0, rejected = 0, errors = 0, disconnects = 0, bytes_in = 0;
+    for (auto& w : workers) {
+        for (int k = 0; k < kKinds; ++k) {
+            latency[k].merge(w->latency[k]);
+            sent[k] += w->sent[k];
+        }
+        login.merge(w->login);
+        delivered += w->delivered;
+        rejected += w->files_rejected;
+        errors += w->errors;
+        disconnects += w->disconnects;
+        bytes_in += w->bytes_in;
+    }
+    uint64_t total_sent = sent[kPublic] + sent[kPrivate] + sent[kHeartbeat] + sent[kFile];
+    // Public chat goes to everyone but the sender
+    uint64_t expected = sent[kPublic] * (ready > 0 ? ready - 1 : 0) + sent[kPrivate];
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "logged in " << ready << "/" << opt.connections << " in " << login_secs << " s ("
+              << shared.failed.load() << " failed), login p50 " << login.percentile(0.5) / 1e6 << " ms, p99 "
+              << login.percentile(0.99) / 1e6 << " ms" << std::endl;
+    std::cout << std::setprecision(0);
+    std::cout << "sent " << total_sent << " in " << std::setprecision(3) << traffic_secs << " s ("
+              << std::setprecision(0) << total_sent / traffic_secs << " msg/s):";
+    for (int k = 0; k < kKinds; ++k) std::cout << " " << kKindNames[k] << " " << sent[k];
+    std::cout << std::endl;
+    std::cout << "delivered " << delivered << "/" << expected << " chat message(s) ("
+              << std::setprecision(2) << (expected ? 100.0 * delivered / expected : 100.0) << "%), "
+              << std::setprecision(0) << delivered / traffic_secs << "/s, " << std::setprecision(1)
+              << bytes_in / traffic_secs / 1e6 << " MB/s received" << std::endl;
+    std::cout << std::setw(10) << "" << std::setw(10) << "count" << std::setw(10) << "p50 ms" << std::setw(10)
+              << "p99 ms" << std::setw(10) << "p999 ms" << std::setw(10) << "max ms" << std::endl;
+    print_latency("public", latency[kPublic]);
+    print_latency("private", latency[kPrivate]);
+    print_latency("file", latency[kFile]);
+    std::cout << rejected << " file request(s) refused (server transfer limit), " << errors << " error(s), "
+              << disconnects << " disconnect(s)" << std::endl;
+    return ready == opt.connections && disconnects == 0 ? 0 : 1;
+}
@@ -0,0 +1,487 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include "../include/buffer.h"
+#include "../include/threadpool.h"
+#include "../include/connection_mgr.h"
+#include "../include/reactor.h"
+#include "../include/business_logic.h"
+#include "../include/logger.h"
+
+// Microbenchmarks of the server's hot paths, run in-process on the real code:
+// packet framing (next_packet) on pipelined and fragmented input,
+// ThreadPool::enqueue/post under producer contention, ConnectionMgr lookups
+// and scans at 1k/10k/100k entries, public-chat fan-out through
+// BusinessLogic and EventLoop::send, and the logger's caller path.
+//
+// Results go to stdout (or --out) as one JSON document, a summary line per
+// case to stderr. Each case runs once to warm up, then --repeat times; the
+// reported ns_per_op is the median, with the min and max alongside, so two
+// runs of the same build can be diffed case by case:
+//
+//   ./bin/microbench > before.json
+//   ./bin/microbench --filter=connmgr --repeat=9 --scale=2 > after.json
+
+struct Options {
+    std::string filter;
+    std::string out;
+    int repeat = 5;
+    double scale = 1.0;  // Multiplies every case's operation count
+};
+
+static Options opt;
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t scaled(size_t n) { return std::max<size_t>(1, (size_t)(n * opt.scale)); }
+
+// One timed run: operations done and how long they took, plus any
+// case-specific numbers (averaged over the repeats)
+struct Sample {
+    uint64_t ops = 0;
+    int64_t ns = 0;
+    std::vector<std::pair<std::string, double>> extra;
+};
+
+struct Result {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;  // Values already JSON-encoded
+    uint64_t ops;
+    double median, min, max;  // ns per op
+    std::vector<std::pair<std::string, double>> extra;
+};
+
+static std::vector<Result> results;
+
+using Params = std::vector<std::pair<std::string, std::string>>;
+
+// Results the compiler must assume are used, so loops are not optimized away
+static volatile uint64_t sink;
+
+static std::string num(double v) {
+    std::ostringstream out;
+    out << std::setprecision(6) << v;
+    return out.str();
+}
+
+static std::string str(const std::string& v) { return "\"" + v + "\""; }
+
+static bool selected(const std::string& name) {
+    return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+}
+
+// Lets a group skip its setup when --filter excludes all of its cases
+static bool any_selected(std::initializer_list<const char*> names) {
+    for (const char* name : names) {
+        if (selected(name)) return true;
+    }
+    return false;
+}
+
+static void run_case(const std::string& name, const Params& params, const std::function<Sample()>& body) {
+    if (!selected(name)) return;
+    body();  // Warm-up: caches, pools, lazily built snapshots
+
+    std::vector<double> per_op;
+    Result result;
+    result.name = name;
+    result.params = params;
+    for (int r = 0; r < opt.repeat; ++r) {
+        Sample s = body();
+        per_op.push_back((double)s.ns / s.ops);
+        result.ops = s.ops;
+        if (result.extra.empty()) {
+            result.extra = s.extra;
+        } else {
+            for (size_t i = 0; i < s.extra.size(); ++i) result.extra[i].second += s.extra[i].second;
+        }
+    }
+    for (auto& e : result.extra) e.second /= opt.repeat;
+    std::sort(per_op.begin(), per_op.end());
+    result.median = per_op[per_op.size() / 2];
+    result.min = per_op.front();
+    result.max = per_op.back();
+    results.push_back(result);
+
+    std::cerr << std::left << std::setw(34) << name;
+    for (auto& p : params) std::cerr << " " << p.first << "=" << p.second;
+    std::cerr << std::right << std::fixed << std::setprecision(1) << "  " << result.median << " ns/op (min "
+              << result.min << ", max " << result.max << ")";
+    for (auto& e : result.extra) std::cerr << " " << e.first << "=" << std::setprecision(1) << e.second;
+    std::cerr << std::defaultfloat << std::endl;
+}
+
+// --- Framing ---
+
+static std::string make_stream(size_t packets, size_t body_len) {
+    std::string stream;
+    std::string body(body_len, 'm');
+    for (size_t i = 0; i < packets; ++i) {
+        PacketHeader header;
+        header.total_len = sizeof(PacketHeader) + body_len;
+        header.msg_type = MSG_CHAT_PUBLIC;
+        header.crc32 = 0;
+        stream.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.append(body);
+    }
+    return stream;
+}
+
+// Feeds the stream in reads of `chunk` bytes (what read_fd would append)
+// and frames after every read, as dispatch_packets does
+static void bench_framing() {
+    struct Case { const char* name; size_t body; size_t chunk; };
+    const Case cases[] = {
+        {"framing/pipelined", 64, 65536},
+        {"framing/pipelined", 1024, 65536},
+        {"framing/fragmented", 64, 13},   // Headers split across reads
+        {"framing/fragmented", 1024, 536},
+    };
+    for (const Case& c : cases) {
+        size_t packets = scaled(c.chunk < 1024 ? 100000 : 400000);
+        std::string stream = make_stream(packets, c.body);
+        run_case(c.name, {{"body", num(c.body)}, {"chunk", num(c.chunk)}}, [&]() {
+            Buffer input;
+            PacketHeader header;
+            PacketView body;
+            uint64_t framed = 0;
+            int64_t start = now_ns();
+            for (size_t pos = 0; pos < stream.size(); pos += c.chunk) {
+                input.append(stream.data() + pos, std::min(c.chunk, stream.size() - pos));
+                while (next_packet(input, header, body) == FrameStatus::Complete) framed++;
+            }
+            sink = framed;
+            Sample s;
+            s.ns = now_ns() - start;
+            s.ops = framed;
+            s.extra.push_back({"mb_per_s", stream.size() * 1e3 / s.ns});
+            return s;
+        });
+    }
+}
+
+// --- ThreadPool ---
+
+static void bench_threadpool() {
+    const size_t kWorkers = 4;
+    for (bool futures : {true, false}) {
+        for (int producers : {1, 4, 8}) {
+            ThreadPool pool(kWorkers);
+            size_t per_producer = scaled(200000) / producers;
+            run_case(futures ? "threadpool/enqueue" : "threadpool/post",
+                     {{"workers", num(kWorkers)}, {"producers", num(producers)}}, [&]() {
+                std::atomic<uint64_t> done{0};
+                std::vector<std::thread> threads;
+                int64_t start = now_ns();
+                for (int p = 0; p < producers; ++p) {
+                    threads.emplace_back([&]() {
+                        for (size_t i = 0; i < per_producer; ++i) {
+                            if (futures) {
+                                pool.enqueue([&done]() { return done.fetch_add(1, std::memory_order_relaxed); });
+                            } else {
+                                pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+                            }
+                        }
+                    });
+                }
+                for (auto& t : threads) t.join();
+                int64_t submitted = now_ns() - start;
+                uint64_t total = per_producer * producers;
+                while (done.load() < total) std::this_thread::yield();
+                Sample s;
+                s.ns = now_ns() - start;  // Until every task has run
+                s.ops = total;
+                s.extra.push_back({"submit_ns_per_op", (double)submitted / total});
+                return s;
+            });
+        }
+    }
+}
+
+// --- ConnectionMgr ---
+
+static void bench_connmgr() {
+    const int kFirstFd = 100;
+    for (size_t entries : {1000, 10000, 100000}) {
+        if (!any_selected({"connmgr/get_user_by_fd", "connmgr/get_user_by_username", "connmgr/scan",
+                           "connmgr/scan_after_churn"})) return;
+        std::string size = num(entries);
+        ConnectionMgr mgr;
+        std::vector<std::string> names;
+        for (size_t i = 0; i < entries; ++i) {
+            auto user = mgr.add_connection(kFirstFd + i);
+            std::shared_ptr<UserContext> displaced;
+            names.push_back("user" + std::to_string(i));
+            mgr.bind_username(user, names.back(), displaced);
+        }
+        std::mt19937 rng(42);
+        size_t lookups = scaled(1000000);
+        std::vector<int> keys(lookups);
+        for (auto& k : keys) k = rng() % entries;
+
+        for (int threads : {1, 4}) {
+            run_case("connmgr/get_user_by_fd", {{"entries", size}, {"threads", num(threads)}}, [&]() {
+                std::vector<std::thread> workers;
+                int64_t start = now_ns();
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&, t]() {
+                        uint64_t hits = 0;
+                        for (size_t i = t; i < keys.size(); i += threads) hits += mgr.get_user_by_fd(kFirstFd + keys[i]) != nullptr;
+                        sink = hits;
+                    });
+                }
+                for (auto& w : workers) w.join();
+                Sample s;
+                s.ns = now_ns() - start;
+                s.ops = keys.size();
+                return s;
+            });
+        }
+
+        run_case("connmgr/get_user_by_username", {{"entries", size}}, [&]() {
+            uint64_t hits = 0;
+            int64_t start = now_ns();
+            for (size_t i = 0; i < keys.size(); ++i) hits += mgr.get_user_by_username(names[keys[i]]) != nullptr;
+            sink = hits;
+            Sample s;
+            s.ns = now_ns() - start;
+            s.ops = keys.size();
+            return s;
+        });
+
+        // Broadcast path with an unchanged membership: the cached snapshot
+        size_t scans = std::max<size_t>(10, scaled(20000000) / entries);
+        run_case("connmgr/scan", {{"entries", size}}, [&]() {
+            uint64_t seen = 0;
+            int64_t start = now_ns();
+            for (size_t i = 0; i < scans; ++i) {
+                UserListPtr users = mgr.get_all_users();
+                for (const auto& user : *users) seen += user->fd;
+            }
+            sink = seen;
+            Sample s;
+            s.ns = now_ns() - start;
+            s.ops = scans;
+            s.extra.push_back({"ns_per_entry", (double)s.ns / (scans * entries)});
+            return s;
+        });
+
+        // One connection leaves and one arrives before every scan: each scan
+        // pays for a snapshot rebuild
+        size_t rebuilds = std::max<size_t>(10, scaled(2000000) / entries);
+        int churn_fd = kFirstFd + entries;
+        run_case("connmgr/scan_after_churn", {{"entries", size}}, [&]() {
+            uint64_t seen = 0;
+            int64_t start = now_ns();
+            for (size_t i = 0; i < rebuilds; ++i) {
+                mgr.remove_connection(churn_fd);
+                mgr.add_connection(churn_fd);
+                seen += mgr.get_all_users()->size();
+            }
+            sink = seen;
+            Sample s;
+            s.ns = now_ns() - start;
+            s.ops = rebuilds;
+            return s;
+        });
+    }
+}
+
+// --- Broadcast fan-out ---
+
+// A public chat through BusinessLogic::process_packet: frame built once,
+// registry snapshot, one EventLoop::send (queue push) per recipient. The
+// loop is initialized but never run, so nothing is written; the queues are
+// emptied between runs, outside the timing.
+static void bench_fanout() {
+    if (!selected("fanout/public_chat")) return;
+    ThreadPool pool(1);
+    EpollServer server(&pool, ServerConfig());
+    EventLoop loop(&server, 0);
+    loop.init(0, "127.0.0.1", false);
+    ConnectionMgr& mgr = server.connections();
+
+    std::vector<std::shared_ptr<UserContext>> users;
+    const int kFirstFd = 1 << 20;  // Never a real descriptor
+    auto grow = [&](size_t n) {
+        while (users.size() < n) {
+            auto user = mgr.add_connection(kFirstFd + users.size(), &loop);
+            std::shared_ptr<UserContext> displaced;
+            mgr.bind_username(user, "peer" + std::to_string(users.size()), displaced);
+            users.push_back(user);
+        }
+    };
+    auto drain = [&]() {
+        for (auto& user : users) {
+            std::lock_guard<std::mutex> lock(user->out_mutex);
+            user->out_queue.clear();
+            user->out_bytes = 0;
+        }
+    };
+
+    struct Case { size_t recipients; size_t content; bool lz4; };
+    const Case cases[] = {{100, 64, false}, {1000, 64, false}, {1000, 1024, true}, {10000, 64, false}};
+    for (const Case& c : cases) {
+        grow(c.recipients + 1);
+        for (auto& user : users) user->lz4 = c.lz4;
+        std::string content;
+        while (content.size() < c.content) content += "the build is green again ";
+        content.resize(c.content);
+        Buffer input;
+        std::string packet;
+        compact_put(packet, "");
+        compact_put(packet, content);
+        input.append(packet.data(), packet.size());
+        PacketView body = input.view(0, packet.size());
+        PacketHeader header;
+        header.total_len = sizeof(PacketHeader) + packet.size();
+        header.msg_type = MSG_CHAT_PUBLIC | FRAME_FLAG_COMPACT;
+        header.crc32 = 0;
+
+        size_t messages = std::max<size_t>(20, scaled(2000000) / c.recipients);
+        run_case("fanout/public_chat",
+                 {{"recipients", num(c.recipients)}, {"content", num(c.content)}, {"lz4", c.lz4 ? "true" : "false"}},
+                 [&]() {
+            int64_t elapsed = 0;
+            // A queue stays short, as if the loop flushed it in between
+            for (size_t done = 0; done < messages; done += 16) {
+                int64_t start = now_ns();
+                for (size_t i = done; i < std::min(messages, done + 16); ++i) {
+                    BusinessLogic::process_packet(users[0], header, body, mgr);
+                }
+                elapsed += now_ns() - start;
+                drain();
+            }
+            Sample s;
+            s.ns = elapsed;
+            s.ops = messages * c.recipients;  // Per delivery
+            s.extra.push_back({"ns_per_message", (double)elapsed / messages});
+            return s;
+        });
+    }
+    for (auto& user : users) mgr.remove_connection(user->fd);
+}
+
+// --- Logger ---
+
+static void bench_logger() {
+    // Bursts that fit the ring, drained in between: the caller's cost, not
+    // that of the drop path a saturated ring would take
+    const size_t kBurst = Logger::kRingCapacity / 2;
+    for (int threads : {1, 4}) {
+        size_t bursts = std::max<size_t>(1, scaled(200000) / kBurst);
+        run_case("logger/log", {{"threads", num(threads)}}, [&]() {
+            uint64_t dropped = Logger::instance().dropped();
+            int64_t logging = 0, writing = 0;
+            for (size_t b = 0; b < bursts; ++b) {
+                std::vector<std::thread> workers;
+                int64_t start = now_ns();
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&, t]() {
+                        for (size_t i = 0; i < kBurst / threads; ++i) {
+                            LOG_INFO("New connection from 127.0.0.1:" + std::to_string(40000 + i) +
+                                     " (fd: " + std::to_string(t * 1000 + i % 1000) + ", loop: 0)");
+                        }
+                    });
+                }
+                for (auto& w : workers) w.join();
+                int64_t logged = now_ns();
+                Logger::instance().flush();
+                logging += logged - start;
+                writing += now_ns() - logged;
+            }
+            Sample s;
+            s.ns = logging;  // Caller side (thread start-up included)
+            s.ops = bursts * (kBurst / threads) * threads;
+            s.extra.push_back({"write_ns_per_op", (double)writing / s.ops});
+            s.extra.push_back({"dropped", (double)(Logger::instance().dropped() - dropped)});
+            return s;
+        });
+    }
+
+    // Below the level: only the check the macro makes
+    Logger::set_level(INFO);
+    size_t calls = scaled(10000000);
+    run_case("logger/filtered", {}, [&]() {
+        int64_t start = now_ns();
+        for (size_t i = 0; i < calls; ++i) LOG_AT(DEBUG, "unused " + std::to_string(i));
+        Sample s;
+        s.ns = now_ns() - start;
+        s.ops = calls;
+        return s;
+    });
+}
+
+static std::string to_json() {
+    std::ostringstream out;
+    out << "{\n  \"suite\": \"microbench\",\n  \"repeat\": " << opt.repeat << ",\n  \"scale\": " << num(opt.scale)
+        << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << str(r.name) << ", \"params\": {";
+        for (size_t p = 0; p < r.params.size(); ++p) {
+            out << (p ? ", " : "") << str(r.params[p].first) << ": " << r.params[p].second;
+        }
+        out << "}, \"ops\": " << r.ops << ", \"ns_per_op\": " << num(r.median) << ", \"min_ns_per_op\": "
+            << num(r.min) << ", \"max_ns_per_op\": " << num(r.max);
+        for (auto& e : r.extra) out << ", " << str(e.first) << ": " << num(e.second);
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = eq == std::string::npos ? arg : arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        try {
+            if (key == "--filter") opt.filter = value;
+            else if (key == "--out") opt.out = value;
+            else if (key == "--repeat") opt.repeat = std::max(1, std::stoi(value));
+            else if (key == "--scale") opt.scale = std::stod(value);
+            else throw std::invalid_argument(key);
+        } catch (const std::exception&) {
+            std::cerr << "Usage: " << argv[0] << " [--filter=substring] [--repeat=5] [--scale=1.0] [--out=file.json]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    // Keep the server's own log lines (and the logger cases) off the output
+    Logger::instance().set_output("/dev/null");
+
+    bench_framing();
+    bench_threadpool();
+    bench_connmgr();
+    bench_fanout();
+    bench_logger();
+
+    std::string json = to_json();
+    if (opt.out.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream file(opt.out);
+        file << json;
+        if (!file) {
+            std::cerr << "Cannot write " << opt.out << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
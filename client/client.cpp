@@ -1,13 +1,17 @@
-#include <fstream>
 #include "client.h"
 #include "../include/protocol.h"
+#include "../include/crc32c.h"
+#include "../include/compression.h"
+#include "frame_limits.h"
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
 #include <iostream>
 
-ChatClient::ChatClient() : socket_fd(-1), running(false) {}
+ChatClient::ChatClient()
+    : socket_fd(-1), running(false), compact_bodies(false), verifier(CrcVerify::All),
+      server_verify(CrcVerify::Off), server_port(0) {}
 
 ChatClient::~ChatClient() {
     stop();
@@ -26,11 +30,21 @@ bool ChatClient::connect_to_server(const std::string& ip, int port) {
         close(socket_fd);
         return false;
     }
+    server_ip = ip;
+    server_port = port;
     
     running = true;
     return true;
 }
 
+void ChatClient::set_crc_verify(CrcVerify mode) {
+    verifier.set_mode(mode);
+}
+
+void ChatClient::request_server_verify(CrcVerify mode) {
+    server_verify = mode;
+}
+
 void ChatClient::stop() {
     running = false;
     if (socket_fd != -1) {
@@ -39,6 +53,15 @@ void ChatClient::stop() {
     }
     if (receiver_thread.joinable()) receiver_thread.join();
     if (heartbeat_thread.joinable()) heartbeat_thread.join();
+
+    // Interrupted downloads keep their .part.meta and resume next time
+    std::lock_guard<std::mutex> lock(downloads_mutex);
+    for (auto& download : downloads) download->cancel();
+    for (auto& t : download_threads) {
+        if (t.joinable()) t.join();
+    }
+    downloads.clear();
+    download_threads.clear();
 }
 
 void ChatClient::send_packet(int32_t msg_type, const void* data, size_t len) {
@@ -47,7 +70,7 @@ void ChatClient::send_packet(int32_t msg_type, const void* data, size_t len) {
     PacketHeader header;
     header.msg_type = msg_type;
     header.total_len = sizeof(PacketHeader) + len;
-    header.crc32 = 0;
+    header.crc32 = static_cast<int32_t>(crc32c(data, len));
 
     std::vector<char> packet(header.total_len);
     memcpy(packet.data(), &header, sizeof(PacketHeader));
@@ -60,12 +83,34 @@ void ChatClient::send_packet(int32_t msg_type, const void* data, size_t len) {
 
 void ChatClient::login(const std::string& user) {
     username = user;
-    LoginBody body;
-    strncpy(body.username, username.c_str(), sizeof(body.username) - 1);
-    send_packet(MSG_LOGIN, &body, sizeof(body));
+    // v1 body understood by every server, offering compact bodies; chat
+    // switches to them once the MSG_LOGIN_ACK confirms. Compressed bodies
+    // are decoded by their flag, whether or not the ACK came first.
+    struct {
+        LoginBody body;
+        uint32_t features;
+    } __attribute__((packed)) login;
+    memset(&login, 0, sizeof(login));
+    strncpy(login.body.username, username.c_str(), sizeof(login.body.username) - 1);
+    login.features = FEATURE_COMPACT_BODIES | FEATURE_LZ4;
+    if (server_verify == CrcVerify::All) login.features |= FEATURE_VERIFY_ALL;
+    else if (server_verify == CrcVerify::Sample) login.features |= FEATURE_VERIFY_SAMPLE;
+    send_packet(MSG_LOGIN, &login, sizeof(login));
+}
+
+void ChatClient::send_chat_compact(int32_t msg_type, const std::string& target, const std::string& message) {
+    std::string body;
+    body.reserve(target.size() + message.size() + 8);
+    compact_put(body, target);
+    compact_put(body, message);
+    send_packet(msg_type | FRAME_FLAG_COMPACT, body.data(), body.size());
 }
 
 void ChatClient::send_chat_public(const std::string& message) {
+    if (compact_bodies) {
+        send_chat_compact(MSG_CHAT_PUBLIC, "", message);
+        return;
+    }
     ChatBody body;
     memset(&body, 0, sizeof(body));
     strncpy(body.content, message.c_str(), sizeof(body.content) - 1);
@@ -73,6 +118,10 @@ void ChatClient::send_chat_public(const std::string& message) {
 }
 
 void ChatClient::send_chat_private(const std::string& target, const std::string& message) {
+    if (compact_bodies) {
+        send_chat_compact(MSG_CHAT_PRIVATE, target, message);
+        return;
+    }
     ChatBody body;
     memset(&body, 0, sizeof(body));
     strncpy(body.target_user, target.c_str(), sizeof(body.target_user) - 1);
@@ -101,15 +150,20 @@ void ChatClient::heartbeat_loop() {
 }
 
 void ChatClient::request_file(const std::string& filename) {
-    pending_filename = filename;
-    FileReqBody body;
-    strncpy(body.filename, filename.c_str(), sizeof(body.filename) - 1);
-    send_packet(MSG_FILE_REQ, &body, sizeof(body));
+    auto download = std::make_shared<SegmentedDownload>(
+        server_ip, server_port, filename, SegmentedDownload::kDefaultConnections, verifier.mode(),
+        [this](const std::string& msg) { if (on_message) on_message(msg); });
+    std::lock_guard<std::mutex> lock(downloads_mutex);
+    downloads.push_back(download);
+    download_threads.emplace_back([download] { download->run(); });
 }
 
 void ChatClient::receiver_loop() {
+    // Holds at most one partial frame plus one read (downloads use their own
+    // connections, see SegmentedDownload)
     std::vector<char> buffer;
-    char temp[4096];
+    std::vector<char> expanded;
+    char temp[65536];
 
     while (running) {
         ssize_t bytes_read = read(socket_fd, temp, sizeof(temp));
@@ -121,56 +175,41 @@ void ChatClient::receiver_loop() {
 
         buffer.insert(buffer.end(), temp, temp + bytes_read);
 
-        while (buffer.size() >= sizeof(PacketHeader)) {
+        size_t consumed = 0;
+        while (buffer.size() - consumed >= sizeof(PacketHeader)) {
             PacketHeader header;
-            memcpy(&header, buffer.data(), sizeof(PacketHeader));
+            memcpy(&header, buffer.data() + consumed, sizeof(PacketHeader));
 
-            if (buffer.size() < (size_t)header.total_len) break;
+            if (header.total_len < (int32_t)sizeof(PacketHeader) || header.total_len > kMaxFrameSize) {
+                if (on_message) on_message("Protocol error: bad frame length from server.");
+                running = false;
+                break;
+            }
+            if (buffer.size() - consumed < (size_t)header.total_len) break;
 
             // Extract body
-            std::string msg_content;
+            const char* body = buffer.data() + consumed + sizeof(PacketHeader);
             size_t body_len = header.total_len - sizeof(PacketHeader);
-            
-            if (header.msg_type == MSG_FILE_DATA) {
-               // Handle File Download
-               if (!pending_filename.empty() && body_len > 0) {
-                   // Append to file (simple implementation, assumes one-shot or sequential packets)
-                   // But wait, server sends header then data. 
-                   // Actually server sends:
-                   // 1. PacketHeader (total_len = Head + FileSize)
-                   // 2. File Content (using sendfile)
-                   // So the 'body' here IS the file content.
-                   
-                   std::ofstream outfile(pending_filename, std::ios::binary | std::ios::app); // Append? Or overwrite? 
-                   // Design: Server sends ONE generic packet with huge body.
-                   // Wait, server logic: header.total_len = header + st_size.
-                   // read_buffer will accumulate ALL OF IT if we are not careful.
-                   // But if file is 1GB, we can't buffer 1GB in memory vector.
-                   // The current client `receiver_loop` buffers EVERYTHING into `buffer` vector.
-                   // This is a limitation of current client design for large files.
-                   // For now, I will stick to this design as I cannot rewrite the whole buffering logic 
-                   // safely without risking breakage. 
-                   // I will save the body content to file.
-                   
-                   if (outfile.is_open()) {
-                        outfile.write(buffer.data() + sizeof(PacketHeader), body_len);
-                        outfile.close();
-                        msg_content = "[File saved to " + pending_filename + "]";
-                        pending_filename.clear(); // Clear after save
-                   } else {
-                        msg_content = "[Error: Could not save file " + pending_filename + "]";
-                   }
-               }
-            } else {
-                 if (body_len > 0) {
-                    char* body_ptr = buffer.data() + sizeof(PacketHeader);
-                    msg_content = std::string(body_ptr, body_len);
-                 }
+            consumed += header.total_len;
+            if (!verifier.check(header.crc32, body, body_len)) {
+                if (on_message) on_message("[Warning: corrupted message from server dropped (checksum mismatch)]");
+                continue;
+            }
+            if ((header.msg_type & FRAME_FLAG_LZ4) && (header.msg_type & kMsgTypeMask) != MSG_LOGIN_ACK) {
+                if (!expand_frame_body(header.msg_type, body, body_len, kMaxFrameSize, expanded)) {
+                    if (on_message) on_message("[Warning: undecodable compressed message from server dropped]");
+                    continue;
+                }
+                body = expanded.data();
+                body_len = expanded.size();
+            }
+            std::string msg_content(body, body_len);
+            if ((header.msg_type & kMsgTypeMask) == MSG_LOGIN_ACK && (header.msg_type & FRAME_FLAG_COMPACT)) {
+                compact_bodies = true;
             }
 
             if (on_message && !msg_content.empty()) on_message(msg_content);
-
-            buffer.erase(buffer.begin(), buffer.begin() + header.total_len);
         }
+        buffer.erase(buffer.begin(), buffer.begin() + consumed);
     }
 }
@@ -5,7 +5,11 @@
 #include <thread>
 #include <atomic>
 #include <functional>
+#include "segmented_download.h"
+#include "../include/crc32c.h"
 #include <vector>
+#include <memory>
+#include <mutex>
 
 class ChatClient {
 public:
@@ -13,9 +17,17 @@ public:
     ~ChatClient();
 
     bool connect_to_server(const std::string& ip, int port);
+    // Checksums checked on what the server sends (chat connection and
+    // downloads). Default: All.
+    void set_crc_verify(CrcVerify mode);
+    // Checking asked of the server for our frames at login (FEATURE_VERIFY_*).
+    // Default: Off, which asks nothing and leaves the server's own setting.
+    void request_server_verify(CrcVerify mode);
     void login(const std::string& username);
     void send_chat_public(const std::string& message);
     void send_chat_private(const std::string& target, const std::string& message);
+    // Downloads filename in the background over parallel ranged connections
+    // (see SegmentedDownload); resumes a previous partial download
     void request_file(const std::string& filename);
     void send_heartbeat();
 
@@ -30,15 +42,23 @@ private:
     int socket_fd;
     std::string username;
     std::atomic<bool> running;
+    std::atomic<bool> compact_bodies;  // Server accepted FEATURE_COMPACT_BODIES at login
+    FrameVerifier verifier;
+    CrcVerify server_verify;  // Requested at login
     std::thread receiver_thread;
     std::thread heartbeat_thread;
     std::function<void(const std::string&)> on_message;
     
-    std::string pending_filename;
+    std::string server_ip;
+    int server_port;
+    std::mutex downloads_mutex;
+    std::vector<std::shared_ptr<SegmentedDownload>> downloads;
+    std::vector<std::thread> download_threads;
 
     void receiver_loop();
     void heartbeat_loop();
     void send_packet(int32_t msg_type, const void* data, size_t len);
+    void send_chat_compact(int32_t msg_type, const std::string& target, const std::string& message);
 };
 
 #endif // CLIENT_H
@@ -0,0 +1,11 @@
+#ifndef FRAME_LIMITS_H
+#define FRAME_LIMITS_H
+
+#include <cstdint>
+
+// Largest frame accepted from the server (file chunks are far smaller), on
+// the chat connection and on download connections alike. Also the bound on
+// the decompressed size of an LZ4 body.
+const int32_t kMaxFrameSize = 16 * 1024 * 1024;
+
+#endif // FRAME_LIMITS_H
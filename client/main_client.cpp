@@ -7,15 +7,26 @@
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        std::cout << "Usage: " << argv[0] << " <username> [server_ip]" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <username> [server_ip] [crc_verify: off|sample|all]" << std::endl;
         return 1;
     }
 
     std::string username = argv[1];
     std::string server_ip = (argc > 2) ? argv[2] : "127.0.0.1";
     int port = 8080;
-
     ChatClient client;
+    // Given explicitly, the level applies both ways: to what we receive and,
+    // asked at login, to what the server checks of ours. Otherwise we check
+    // everything we receive and leave the server at its own setting.
+    if (argc > 3) {
+        CrcVerify crc_verify;
+        if (!crc_verify_from_name(argv[3], crc_verify)) {
+            std::cout << "crc_verify must be off, sample or all" << std::endl;
+            return 1;
+        }
+        client.set_crc_verify(crc_verify);
+        client.request_server_verify(crc_verify);
+    }
     if (!client.connect_to_server(server_ip, port)) {
         std::cerr << "Failed to connect to server." << std::endl;
         return 1;
@@ -0,0 +1,372 @@
+#include "segmented_download.h"
+#include "../include/protocol.h"
+#include "../include/compression.h"
+#include "frame_limits.h"
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+
+static bool read_full(int fd, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+SegmentedDownload::SegmentedDownload(const std::string& server_ip, int server_port, const std::string& name,
+                                     int conns, CrcVerify verify_mode, std::function<void(const std::string&)> cb)
+    : ip(server_ip), port(server_port), filename(name), part_path(name + ".part"),
+      meta_path(name + ".part.meta"), connections(conns > 0 ? conns : 1), verify(verify_mode), report(cb),
+      part_fd(-1), file_size(0), cancelled(false), meta_seq(0), meta_written(0) {}
+
+int SegmentedDownload::connect_server() {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    inet_pton(AF_INET, ip.c_str(), &server_addr.sin_addr);
+    if (connect(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cancelled) {
+        close(fd);
+        return -1;
+    }
+    sockets.push_back(fd);
+    return fd;
+}
+
+static void release_socket(std::mutex& mutex, std::vector<int>& sockets, int fd) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sockets.erase(std::remove(sockets.begin(), sockets.end(), fd), sockets.end());
+    close(fd);
+}
+
+bool SegmentedDownload::request_range(int fd, uint64_t offset, uint64_t length) {
+    struct {
+        PacketHeader header;
+        FileRangeReqBody body;
+        uint32_t features;
+    } __attribute__((packed)) packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.header.total_len = sizeof(packet);
+    packet.header.msg_type = MSG_FILE_REQ;
+    strncpy(packet.body.filename, filename.c_str(), sizeof(packet.body.filename) - 1);
+    packet.body.offset = offset;
+    packet.body.length = length;
+    packet.features = FEATURE_LZ4;
+    packet.header.crc32 = static_cast<int32_t>(crc32c(&packet.body, sizeof(packet.body) + sizeof(packet.features)));
+    return write_full(fd, &packet, sizeof(packet));
+}
+
+bool SegmentedDownload::read_frame(int fd, FrameVerifier& verifier, int32_t& msg_type, std::vector<char>& body) {
+    PacketHeader header;
+    if (!read_full(fd, &header, sizeof(header))) return false;
+    if (header.total_len < (int32_t)sizeof(PacketHeader) || header.total_len > kMaxFrameSize) return false;
+    msg_type = header.msg_type;
+    body.resize(header.total_len - sizeof(PacketHeader));
+    if (!body.empty() && !read_full(fd, body.data(), body.size())) return false;
+    if (!verifier.check(header.crc32, body.data(), body.size())) {
+        report("[Error: checksum mismatch while downloading " + filename + "]");
+        return false;
+    }
+    if (msg_type & FRAME_FLAG_LZ4) {
+        std::vector<char> expanded;
+        if (!expand_frame_body(msg_type, body.data(), body.size(), kMaxFrameSize, expanded)) {
+            report("[Error: undecodable compressed chunk while downloading " + filename + "]");
+            return false;
+        }
+        body.swap(expanded);
+        msg_type &= ~FRAME_FLAG_LZ4;
+    }
+    return true;
+}
+
+bool SegmentedDownload::probe_size() {
+    // A one-byte range: its MSG_FILE_START carries the file size
+    int fd = connect_server();
+    if (fd < 0) {
+        report("[Error: cannot connect for download of " + filename + "]");
+        return false;
+    }
+
+    bool ok = false;
+    bool have_size = false;
+    std::vector<char> body;
+    int32_t msg_type;
+    FrameVerifier verifier(verify);
+    if (request_range(fd, 0, 1)) {
+        while (read_frame(fd, verifier, msg_type, body)) {
+            if (msg_type == MSG_FILE_START && body.size() >= sizeof(FileStartBody)) {
+                FileStartBody start;
+                memcpy(&start, body.data(), sizeof(start));
+                file_size = start.file_size;
+                have_size = true;
+            } else if (msg_type == MSG_FILE_END) {
+                ok = have_size;
+                break;
+            } else if (msg_type == MSG_ERROR) {
+                report(std::string(body.begin(), body.end()));
+                break;
+            }
+        }
+    }
+    release_socket(mutex, sockets, fd);
+    return ok;
+}
+
+bool SegmentedDownload::load_meta() {
+    std::ifstream in(meta_path);
+    if (!in) return false;
+
+    std::string key;
+    uint64_t size;
+    if (!(in >> key >> size) || key != "size" || size != file_size) return false;
+
+    std::vector<Segment> loaded;
+    uint64_t expect = 0;
+    Segment seg;
+    while (in >> seg.begin >> seg.end >> seg.done) {
+        if (seg.begin != expect || seg.end < seg.begin || seg.done > seg.end - seg.begin) return false;
+        seg.saved = seg.done;
+        loaded.push_back(seg);
+        expect = seg.end;
+    }
+    if (loaded.empty() || expect != file_size) return false;
+
+    segments.swap(loaded);
+    return true;
+}
+
+void SegmentedDownload::plan_segments() {
+    uint64_t count = std::max<uint64_t>(1, std::min<uint64_t>(connections, file_size / kMinSegment));
+    uint64_t step = file_size / count;
+    segments.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t begin = i * step;
+        uint64_t end = (i + 1 == count) ? file_size : begin + step;
+        segments.push_back(Segment{begin, end, 0, 0});
+    }
+}
+
+std::string SegmentedDownload::snapshot_meta(uint64_t& seq) {
+    std::ostringstream out;
+    out << "size " << file_size << "\n";
+    for (auto& seg : segments) {
+        out << seg.begin << " " << seg.end << " " << seg.done << "\n";
+        seg.saved = seg.done;
+    }
+    seq = ++meta_seq;
+    return out.str();
+}
+
+void SegmentedDownload::write_meta(const std::string& text, uint64_t seq) {
+    // The snapshot is taken only after the bytes it reports were pwrite()n,
+    // so the meta file never claims more than the .part file holds. Written
+    // to a temporary file and renamed, so it is never seen half-written.
+    // The fsyncs keep both true across a crash: the data is on disk before
+    // the meta that reports it, the new meta before the rename to it, and
+    // the rename itself once the directory is synced. The segment threads
+    // keep receiving meanwhile; only savers wait for each other.
+    std::lock_guard<std::mutex> lock(save_mutex);
+    if (seq <= meta_written) return;  // A newer snapshot overtook this one
+    if (part_fd >= 0 && fdatasync(part_fd) < 0) return;
+
+    std::string tmp = meta_path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    bool ok = write_full(fd, text.data(), text.size()) && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), meta_path.c_str()) < 0) return;
+    meta_written = seq;
+
+    size_t slash = meta_path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : meta_path.substr(0, slash + 1);
+    int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+}
+
+bool SegmentedDownload::fetch_segment(size_t index) {
+    uint64_t offset, remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Segment& seg = segments[index];
+        offset = seg.begin + seg.done;
+        remaining = seg.end - offset;
+    }
+    if (remaining == 0) return true;
+
+    int fd = connect_server();
+    if (fd < 0) return false;
+
+    bool ok = false;
+    std::vector<char> body;
+    int32_t msg_type;
+    FrameVerifier verifier(verify);
+    if (request_range(fd, offset, remaining)) {
+        while (!ok && read_frame(fd, verifier, msg_type, body)) {
+            if (msg_type == MSG_FILE_START) {
+                FileStartBody start;
+                if (body.size() < sizeof(start)) break;
+                memcpy(&start, body.data(), sizeof(start));
+                if (start.file_size != file_size || start.range_offset != offset) {
+                    report("[Error: " + filename + " changed on the server, delete " + meta_path + " to restart]");
+                    break;
+                }
+            } else if (msg_type == MSG_FILE_DATA) {
+                FileChunkHeader chunk;
+                if (body.size() < sizeof(chunk)) break;
+                memcpy(&chunk, body.data(), sizeof(chunk));
+                // Chunks of one transfer arrive in order on its connection
+                if (chunk.offset != offset || chunk.length != body.size() - sizeof(chunk) ||
+                    chunk.length > remaining) {
+                    break;
+                }
+
+                const char* data = body.data() + sizeof(chunk);
+                size_t written = 0;
+                while (written < chunk.length) {
+                    ssize_t n = pwrite(part_fd, data + written, chunk.length - written, offset + written);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) break;
+                    written += n;
+                }
+                if (written < chunk.length) {
+                    report("[Error: write failed for " + part_path + "]");
+                    break;
+                }
+                offset += chunk.length;
+                remaining -= chunk.length;
+
+                std::string meta;
+                uint64_t seq = 0;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    Segment& seg = segments[index];
+                    seg.done += chunk.length;
+                    if (seg.done - seg.saved >= kMetaInterval) meta = snapshot_meta(seq);
+                }
+                if (seq) write_meta(meta, seq);
+            } else if (msg_type == MSG_FILE_END) {
+                FileEndBody end;
+                if (body.size() < sizeof(end)) break;
+                memcpy(&end, body.data(), sizeof(end));
+                ok = end.status == 0 && remaining == 0;
+                break;
+            } else if (msg_type == MSG_ERROR) {
+                report(std::string(body.begin(), body.end()));
+                break;
+            }
+        }
+    }
+    release_socket(mutex, sockets, fd);
+    return ok;
+}
+
+bool SegmentedDownload::run() {
+    if (!probe_size()) return false;
+
+    part_fd = open(part_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (part_fd < 0) {
+        report("[Error: Could not save file " + filename + "]");
+        return false;
+    }
+
+    uint64_t resumed = 0;
+    std::string meta;
+    uint64_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (load_meta()) {
+            for (const auto& seg : segments) resumed += seg.done;
+        } else {
+            plan_segments();
+            if (ftruncate(part_fd, file_size) < 0) {
+                report("[Error: Could not size " + part_path + "]");
+                close(part_fd);
+                return false;
+            }
+            meta = snapshot_meta(seq);
+        }
+    }
+    if (seq) write_meta(meta, seq);
+    if (resumed > 0) {
+        report("[Resuming " + filename + " at " + std::to_string(resumed) + "/" +
+               std::to_string(file_size) + " bytes]");
+    } else {
+        report("[Downloading " + filename + " (" + std::to_string(file_size) + " bytes, " +
+               std::to_string(segments.size()) + " connection(s))]");
+    }
+
+    std::vector<char> results(segments.size(), 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        threads.emplace_back([this, i, &results] { results[i] = fetch_segment(i); });
+    }
+    for (auto& t : threads) t.join();
+
+    uint64_t done = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        meta = snapshot_meta(seq);
+        for (const auto& seg : segments) done += seg.done;
+    }
+    write_meta(meta, seq);
+    close(part_fd);
+    part_fd = -1;
+
+    bool complete = std::all_of(results.begin(), results.end(), [](char r) { return r != 0; });
+    if (!complete || done != file_size) {
+        report("[Download of " + filename + " stopped at " + std::to_string(done) + "/" +
+               std::to_string(file_size) + " bytes; /download it again to resume]");
+        return false;
+    }
+
+    if (rename(part_path.c_str(), filename.c_str()) < 0) {
+        report("[Error: Could not rename " + part_path + "]");
+        return false;
+    }
+    unlink(meta_path.c_str());
+    report("[File saved to " + filename + "]");
+    return true;
+}
+
+void SegmentedDownload::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled = true;
+    for (int fd : sockets) shutdown(fd, SHUT_RDWR);
+}
@@ -0,0 +1,80 @@
+#ifndef SEGMENTED_DOWNLOAD_H
+#define SEGMENTED_DOWNLOAD_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "../include/crc32c.h"
+
+// Downloads one file as byte ranges over parallel connections.
+// Every segment gets its own socket and thread and sends a ranged
+// MSG_FILE_REQ; its chunks are pwrite()n into <name>.part at their offsets.
+// Progress goes to <name>.part.meta, so a download that was interrupted
+// resumes each segment where it stopped. When all segments are complete
+// the .part file is renamed to <name> and the meta file removed.
+// The extra connections do not log in, so they never displace the chat
+// session; each asks for compressed chunks (FEATURE_LZ4) in its request.
+// Chunks that fail their checksum (per verify) are not written and
+// stop their segment, which a later run resumes from there.
+class SegmentedDownload {
+public:
+    static constexpr int kDefaultConnections = 4;
+    static constexpr uint64_t kMinSegment = 1024 * 1024;       // Smaller files use fewer connections
+    static constexpr uint64_t kMetaInterval = 4 * 1024 * 1024;  // Progress saved at least this often
+
+    SegmentedDownload(const std::string& ip, int port, const std::string& filename,
+                      int connections, CrcVerify verify, std::function<void(const std::string&)> report);
+
+    // Blocking: runs the whole download. True when the file is complete.
+    bool run();
+    // Thread-safe: aborts run() by shutting the segment sockets down
+    void cancel();
+
+private:
+    struct Segment {
+        uint64_t begin;
+        uint64_t end;
+        uint64_t done;   // Bytes on disk from begin
+        uint64_t saved;  // done as of the last meta save
+    };
+
+    std::string ip;
+    int port;
+    std::string filename;
+    std::string part_path;
+    std::string meta_path;
+    int connections;
+    CrcVerify verify;
+    std::function<void(const std::string&)> report;
+
+    int part_fd;
+    uint64_t file_size;
+    std::mutex mutex;               // Guards segments, sockets and meta_seq
+    std::vector<Segment> segments;
+    std::vector<int> sockets;
+    std::atomic<bool> cancelled;
+    uint64_t meta_seq;              // Snapshots taken so far
+    std::mutex save_mutex;          // Serializes meta file writes; never held with mutex
+    uint64_t meta_written;          // Newest snapshot on disk (guarded by save_mutex)
+
+    int connect_server();
+    bool request_range(int fd, uint64_t offset, uint64_t length);
+    // False on a closed connection, a bad length or a failed checksum.
+    // Compressed bodies come back expanded, msg_type without FRAME_FLAG_LZ4.
+    bool read_frame(int fd, FrameVerifier& verifier, int32_t& msg_type, std::vector<char>& body);
+    bool probe_size();
+    bool load_meta();
+    void plan_segments();
+    // Caller holds mutex: the meta text for the current progress, numbered
+    // in seq, marking it saved. Cheap; the disk work is write_meta()'s.
+    std::string snapshot_meta(uint64_t& seq);
+    // Caller does not hold mutex: syncs the .part file and replaces the
+    // meta file with text, unless a newer snapshot was written already
+    void write_meta(const std::string& text, uint64_t seq);
+    bool fetch_segment(size_t index);
+};
+
+#endif // SEGMENTED_DOWNLOAD_H
@@ -0,0 +1,39 @@
+#ifndef ADMIN_SERVER_H
+#define ADMIN_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Local admin endpoint: a unix stream socket served by its own thread, so
+// polling it never runs on (or waits for) a reactor or a worker.
+// One command per connection: the client writes a line, the handler's
+// answer is written back and the connection is closed. Access is whatever
+// the socket file's permissions allow.
+class AdminServer {
+public:
+    using Handler = std::function<std::string(const std::string& command)>;
+
+    AdminServer(const std::string& path, Handler handler);
+    ~AdminServer();  // Stops the thread and removes the socket file
+
+    AdminServer(const AdminServer&) = delete;
+    AdminServer& operator=(const AdminServer&) = delete;
+
+    // Binds and starts serving. False (logged) if the path is unusable or
+    // another server is already listening on it.
+    bool start();
+
+private:
+    std::string path;
+    Handler handler;
+    int listen_fd;
+    std::atomic<bool> stopping;
+    std::thread thread;
+
+    void serve();
+    void answer(int fd);
+};
+
+#endif // ADMIN_SERVER_H
@@ -0,0 +1,122 @@
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Receive memory shared between a reactor and the workers.
+//
+// A connection's Buffer reads into a RecvBlock taken from BlockPool. Framed
+// packets are handed to workers as PacketViews (pointer + length + a
+// reference on the block), so a body is never copied between the read()
+// and the handler. When the last view and the Buffer let go of a block it
+// goes back to the pool instead of the heap.
+
+class BlockPool;
+
+struct RecvBlock {
+    std::atomic<int> refs;
+    size_t capacity;
+    int size_class;
+    // data follows the header in the same allocation
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+// Intrusive reference to a RecvBlock (no separate control block allocation)
+class BlockRef {
+public:
+    BlockRef() : block(nullptr) {}
+    explicit BlockRef(RecvBlock* b) : block(b) {}  // Adopts a fresh block (refs == 1)
+    BlockRef(const BlockRef& other) : block(other.block) { acquire(); }
+    BlockRef(BlockRef&& other) noexcept : block(other.block) { other.block = nullptr; }
+    ~BlockRef() { release(); }
+
+    BlockRef& operator=(BlockRef other) noexcept {
+        RecvBlock* tmp = block;
+        block = other.block;
+        other.block = tmp;
+        return *this;
+    }
+
+    RecvBlock* get() const { return block; }
+    explicit operator bool() const { return block != nullptr; }
+    char* data() const { return block ? block->data() : nullptr; }
+    size_t capacity() const { return block ? block->capacity : 0; }
+    // True when no PacketView still points into the block
+    bool unique() const { return block && block->refs.load(std::memory_order_acquire) == 1; }
+    void reset() { release(); block = nullptr; }
+
+private:
+    RecvBlock* block;
+
+    void acquire() {
+        if (block) block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void release();
+};
+
+// Size-classed free lists of RecvBlocks (powers of two from kMinBlock).
+class BlockPool {
+public:
+    static const size_t kMinBlock = 4096;
+    static const int kClasses = 13;                 // 4 KB .. 16 MB
+    static const size_t kMaxCachedBytes = 64 << 20; // Per class
+
+    static BlockPool& instance();
+
+    // Returns a block with capacity >= min_capacity and refs == 1
+    BlockRef acquire(size_t min_capacity);
+    void recycle(RecvBlock* block);
+
+    // Blocks currently handed out (for tests/diagnostics)
+    size_t outstanding() const { return live_blocks.load(std::memory_order_relaxed); }
+
+private:
+    struct FreeList {
+        std::mutex mutex;
+        std::vector<RecvBlock*> blocks;
+    };
+    FreeList free_lists[kClasses];
+    std::atomic<size_t> live_blocks{0};
+
+    BlockPool() = default;
+};
+
+inline void BlockRef::release() {
+    if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        BlockPool::instance().recycle(block);
+    }
+}
+
+// Read-only slice of a packet body, kept alive by a reference on its block.
+struct PacketView {
+    BlockRef block;
+    const char* ptr = nullptr;
+    size_t len = 0;
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+
+    // In-place typed access to a fixed body struct; nullptr if too short.
+    // Only for structs made of char arrays (alignment 1).
+    template <typename T>
+    const T* as() const {
+        static_assert(alignof(T) == 1, "PacketView::as() needs a byte-aligned struct");
+        return len >= sizeof(T) ? reinterpret_cast<const T*>(ptr) : nullptr;
+    }
+
+    // Copy of a fixed body struct of any alignment; false if too short
+    template <typename T>
+    bool copy_to(T& out) const {
+        if (len < sizeof(T)) return false;
+        memcpy(&out, ptr, sizeof(T));
+        return true;
+    }
+};
+
+#endif // BLOCK_POOL_H
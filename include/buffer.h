@@ -0,0 +1,85 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <cstddef>
+#include <sys/types.h>
+#include "block_pool.h"
+#include "protocol.h"
+
+// Per-connection input buffer with read/write cursors over a pooled RecvBlock.
+//
+//   +-------------------+------------------+------------------+
+//   |  consumed bytes   |  readable bytes  |  writable bytes  |
+//   +-------------------+------------------+------------------+
+//   0            read_index          write_index         capacity
+//
+// Consuming a packet only advances read_index. Unread bytes are moved to the
+// front only when the tail runs out of room, so compaction copies at most the
+// pending partial packet and its cost is amortized over the reads that filled
+// the buffer (no memmove of the whole buffer per packet).
+//
+// Consumed bytes may still be referenced by PacketViews handed to workers.
+// While that is the case the block is never rewritten in place: the buffer
+// keeps appending at the tail and, when it runs out, moves the pending bytes
+// to a fresh pooled block and leaves the old one to the views.
+//
+// The block is only held while bytes are pending: it is taken from the pool
+// by the first read and given back as soon as the buffer drains (views still
+// reading it keep it alive), so an idle connection holds no receive memory.
+class Buffer {
+public:
+    static const size_t kInitialSize = BlockPool::kMinBlock;
+    static const size_t kExtraReadSize = 65536; // Stack overflow area for readv
+
+    // initial_size: capacity of each block taken for an empty buffer
+    explicit Buffer(size_t initial_size = kInitialSize);
+
+    size_t readable() const { return write_index - read_index; }
+    size_t writable() const { return block.capacity() - write_index; }
+    const char* peek() const { return block.data() + read_index; }
+
+    // Zero-copy slice of the readable bytes [offset, offset + len).
+    // Stays valid after retrieve() and after the buffer moves on.
+    PacketView view(size_t offset, size_t len) const;
+
+    // Consumes n readable bytes (n <= readable())
+    void retrieve(size_t n);
+    void retrieve_all();
+
+    void append(const char* data, size_t len);
+
+    // One readv() straight into the writable tail plus a 64 KB stack area,
+    // so a single call can pull a large burst without pre-growing the buffer.
+    // An empty buffer takes a block for the call and reads into it directly;
+    // a read that finds nothing (EAGAIN or EOF) gives it straight back.
+    // Returns what read() returns; errno is preserved on failure.
+    ssize_t read_fd(int fd);
+
+    // True while the buffer holds a pooled block (for tests/diagnostics)
+    bool has_block() const { return static_cast<bool>(block); }
+
+private:
+    BlockRef block;  // Null while the buffer is empty
+    size_t initial_size;
+    size_t read_index;
+    size_t write_index;
+
+    // Guarantees writable() >= len by compacting or moving to another block
+    void make_space(size_t len);
+};
+
+// Largest frame a client may send (header included); anything longer, or
+// shorter than a header, is a protocol error
+const int32_t kMaxPacketLen = 10 * 1024 * 1024;
+
+enum class FrameStatus {
+    Complete,  // header and body filled in, packet consumed
+    NeedMore,  // no whole packet buffered yet; nothing consumed
+    Invalid    // bad length in the next header; the connection must go
+};
+
+// Frames the next packet at the front of input (the sticky/partial packet
+// handling of every reactor). The body is a view into the receive block.
+FrameStatus next_packet(Buffer& input, PacketHeader& header, PacketView& body);
+
+#endif // BUFFER_H
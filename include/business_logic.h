@@ -3,18 +3,35 @@
 
 #include <vector>
 #include <memory>
+#include <string_view>
 #include "protocol.h"
 #include "connection_mgr.h"
+#include "block_pool.h"
 
 class BusinessLogic {
 public:
-    static void process_packet(std::shared_ptr<UserContext> user, PacketHeader header, std::vector<char> body, ConnectionMgr& conn_mgr);
+    // body is a view into the connection's receive block; handlers parse it in place
+    static void process_packet(const std::shared_ptr<UserContext>& user, const PacketHeader& header, const PacketView& body, ConnectionMgr& conn_mgr);
 
 private:
-    static void handle_login(std::shared_ptr<UserContext> user, std::vector<char>& body, ConnectionMgr& conn_mgr);
-    static void handle_chat_public(std::shared_ptr<UserContext> user, std::vector<char>& body, ConnectionMgr& conn_mgr);
-    static void handle_chat_private(std::shared_ptr<UserContext> user, std::vector<char>& body, ConnectionMgr& conn_mgr);
-    static void send_to_fd(int fd, int32_t msg_type, const std::string& data);
+    // Chat body fields in either encoding, as views into the packet body
+    struct ChatFields {
+        std::string_view target;
+        std::string_view content;
+    };
+
+    // Decode v1 fixed structs or compact bodies (FRAME_FLAG_COMPACT) without
+    // copying; false if the body is malformed
+    static bool parse_login(const PacketView& body, bool compact, std::string_view& username, uint32_t& features);
+    static bool parse_chat(const PacketView& body, bool compact, ChatFields& chat);
+
+    static void handle_login(const std::shared_ptr<UserContext>& user, const PacketView& body, bool compact, ConnectionMgr& conn_mgr);
+    static void handle_chat_public(const std::shared_ptr<UserContext>& user, const PacketView& body, bool compact, ConnectionMgr& conn_mgr);
+    static void handle_chat_private(const std::shared_ptr<UserContext>& user, const PacketView& body, bool compact, ConnectionMgr& conn_mgr);
+    static void handle_file_request(const std::shared_ptr<UserContext>& user, const PacketView& body);
+    // Queues a frame on user's outbound queue; the owning reactor writes it
+    static void send_to_user(const std::shared_ptr<UserContext>& user, int32_t msg_type, std::string data);
+    static void send_frame(const std::shared_ptr<UserContext>& user, const FramePtr& frame);
 };
 
 #endif // BUSINESS_LOGIC_H
@@ -0,0 +1,46 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// LZ4 block format (what LZ4_compress_default / LZ4_decompress_safe
+// produce and accept), implemented here so nothing extra has to be
+// installed. Greedy single-probe matcher: fast, with the usual LZ4 ratio on
+// text, logs and JSON; incompressible input is detected by its output not
+// shrinking and then sent as is.
+
+// Largest output lz4_compress() can produce for len bytes
+size_t lz4_compress_bound(size_t len);
+
+// Compresses len bytes of src into dst. Returns the compressed size, or 0
+// if it does not fit in capacity bytes.
+size_t lz4_compress(const void* src, size_t len, char* dst, size_t capacity);
+
+// Decompresses a block that must expand to exactly raw_len bytes. False on
+// malformed input; never reads or writes outside the given buffers.
+bool lz4_decompress(const void* src, size_t len, char* dst, size_t raw_len);
+
+// Appends the LZ4 block of len bytes of data to out if it is smaller than
+// the data; otherwise returns false and leaves out unchanged. Counted in
+// compression_stats().
+bool compress_block(const void* data, size_t len, std::string& out);
+
+// Body of a frame received with FRAME_FLAG_LZ4 (protocol.h), expanded
+// into out. False if it is malformed or would exceed max_size.
+bool expand_frame_body(int32_t msg_type, const char* body, size_t len, size_t max_size, std::vector<char>& out);
+
+// Process-wide totals of compress_block()
+struct CompressionStats {
+    uint64_t blocks;            // Calls
+    uint64_t raw_bytes;         // Input of the blocks that shrank
+    uint64_t compressed_bytes;  // Their output
+    uint64_t stored_bytes;      // Input of the blocks that did not (sent as is)
+    uint64_t nanos;             // Time spent compressing, all blocks
+};
+
+CompressionStats compression_stats();
+
+#endif // COMPRESSION_H
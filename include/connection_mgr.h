@@ -1,81 +1,128 @@
 #ifndef CONNECTION_MGR_H
 #define CONNECTION_MGR_H
 
-#include <map>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <deque>
 #include <string>
 #include <memory>
 #include <mutex>
 #include <vector>
-#include <ctime>
 #include "protocol.h"
+#include "frame.h"
+#include "crc32c.h"
+#include "server_config.h"
+#include "timing_wheel.h"
+#include "buffer.h"
+#include "file_transfer.h"
+
+class EventLoop;
+class SerialExecutor;
 
 struct UserContext {
     int fd;
     std::string username;
-    std::vector<char> read_buffer; // Accumulator for sticky packets
-    time_t last_heartbeat;
+    Buffer read_buffer;            // Accumulator for sticky packets (loop thread only)
+    std::atomic<int64_t> last_heartbeat; // monotonic_ms() of the last heartbeat
+    EventLoop* loop;               // Owning reactor; only it may touch/close fd
+    bool closed;                   // Set by the owning loop once fd is closed
+
+    // Outbound queue: appended by any thread through EventLoop::send(),
+    // drained only by the owning loop (sendmsg, then EPOLLOUT while blocked).
+    std::mutex out_mutex;
+    std::deque<FramePtr> out_queue;
+    size_t out_offset;             // Bytes of out_queue.front() already written (header + payload)
+    size_t out_bytes;              // Unsent bytes in out_queue
+    bool flush_pending;            // Loop will flush without further notification
+    bool write_armed;              // EPOLLOUT registered / io_uring send in flight (loop thread only)
+    bool slow_consumer;            // Hit the high-water mark under Disconnect policy
+    uint64_t dropped_frames;       // Frames discarded under Drop policy
+    std::deque<FileJobPtr> file_jobs; // Downloads, sent one after another between frames
+
+    bool unregistered;             // Removed from ConnectionMgr (guarded by its name_mutex)
+
+    // Checksums of the frames received on this connection (workers)
+    FrameVerifier verifier;
+    // Negotiated FEATURE_LZ4 at login: frames above compress_min go out in
+    // their compressed form (OutFrame::compressed)
+    std::atomic<bool> lz4;
+
+    // Serializes this connection's handlers (DispatchMode::Serial only)
+    std::shared_ptr<SerialExecutor> executor;
     
-    UserContext(int socket_fd) : fd(socket_fd), last_heartbeat(time(nullptr)) {}
+    UserContext(int socket_fd, EventLoop* owner = nullptr)
+        : fd(socket_fd), last_heartbeat(monotonic_ms()), loop(owner), closed(false),
+          out_offset(0), out_bytes(0), flush_pending(false), write_armed(false),
+          slow_consumer(false), dropped_frames(0), unregistered(false), lz4(false) {}
 };
 
+using UserList = std::vector<std::shared_ptr<UserContext>>;
+using UserListPtr = std::shared_ptr<const UserList>;
+
+// Concurrent connection registry.
+// - fd lookups go to one of kShards shards (fd % kShards), each guarded by its
+//   own shared_mutex, so readers only ever share a lock with readers of the
+//   same shard and writers block 1/kShards of the table.
+// - the username index is read-mostly (DM routing) behind a shared_mutex;
+//   it is only written on login and disconnect.
+// - full scans (broadcast) read an immutable snapshot published
+//   RCU-style with std::atomic_load/atomic_store. It is rebuilt lazily by the
+//   first scan after membership changed, so scans take no registry lock.
 class ConnectionMgr {
 public:
-    void add_connection(int fd) {
-        std::lock_guard<std::mutex> lock(map_mutex);
-        connections[fd] = std::make_shared<UserContext>(fd);
-    }
-
-    void remove_connection(int fd) {
-        std::lock_guard<std::mutex> lock(map_mutex);
-        connections.erase(fd);
-    }
-
-    std::shared_ptr<UserContext> get_user_by_fd(int fd) {
-        std::lock_guard<std::mutex> lock(map_mutex);
-        auto it = connections.find(fd);
-        if (it != connections.end()) {
-            return it->second;
-        }
-        return nullptr;
-    }
-
-    int get_fd_by_username(const std::string& username) {
-        std::lock_guard<std::mutex> lock(map_mutex);
-        for (const auto& kv : connections) {
-            if (kv.second->username == username) {
-                return kv.first;
-            }
-        }
-        return -1;
-    }
+    ConnectionMgr();
+
+    void set_duplicate_login_policy(DuplicateLoginPolicy policy);
+
+    std::shared_ptr<UserContext> add_connection(int fd, EventLoop* loop = nullptr);
+    void remove_connection(int fd);
+
+    // Binds username to user in the name index. If the name is held by another
+    // connection the duplicate-login policy decides: KickOld rebinds it and
+    // returns the previous holder in displaced (caller closes it), RejectNew
+    // returns false and leaves everything untouched.
+    bool bind_username(const std::shared_ptr<UserContext>& user, const std::string& username,
+                       std::shared_ptr<UserContext>& displaced);
+
+    std::shared_ptr<UserContext> get_user_by_fd(int fd);
+    int get_fd_by_username(const std::string& username);
+    std::shared_ptr<UserContext> get_user_by_username(const std::string& username);
+
+    // Snapshot of all connected users (for broadcast). Never blocks writers;
+    // connections added after the snapshot was taken are not included.
+    UserListPtr get_all_users();
 
     // Helper to get all connected users (for broadcast)
-    std::vector<int> get_all_fds() {
-        std::lock_guard<std::mutex> lock(map_mutex);
-        std::vector<int> fds;
-        for (const auto& kv : connections) {
-            fds.push_back(kv.first);
-        }
-        return fds;
-    }
-
-    // Returns list of timed-out fds
-    std::vector<int> check_timeouts(int timeout_seconds) {
-        std::lock_guard<std::mutex> lock(map_mutex);
-        std::vector<int> dead_fds;
-        time_t now = time(nullptr);
-        
-        for (const auto& kv : connections) {
-            if (now - kv.second->last_heartbeat > timeout_seconds) {
-                dead_fds.push_back(kv.first);
-            }
-        }
-        return dead_fds;
-    }
+    std::vector<int> get_all_fds();
 
 private:
-    std::map<int, std::shared_ptr<UserContext>> connections;
-    std::mutex map_mutex;
+    static const int kShards = 64;
+
+    struct Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<int, std::shared_ptr<UserContext>> connections;
+    };
+
+    Shard shards[kShards];
+
+    std::shared_mutex name_mutex;
+    std::unordered_map<std::string, std::shared_ptr<UserContext>> by_username;
+    DuplicateLoginPolicy duplicate_policy;
+
+    // Bumped on every add/remove; a snapshot remembers which version it saw
+    struct Snapshot {
+        uint64_t version;
+        UserList users;
+    };
+    std::atomic<uint64_t> membership_version;
+    std::mutex rebuild_mutex;  // Serializes rebuilds only, never taken by fresh reads
+    std::shared_ptr<const Snapshot> snapshot;
+
+    Shard& shard_for(int fd) { return shards[(unsigned)fd % kShards]; }
+
+    // Drops user's current name from the index. Caller holds name_mutex.
+    void unindex_username(const std::shared_ptr<UserContext>& user);
 };
 
 #endif // CONNECTION_MGR_H
@@ -0,0 +1,64 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// CRC32C (Castagnoli), the checksum carried in PacketHeader::crc32.
+// Uses the SSE4.2 crc32 instruction when the CPU has it (checked once at
+// run time), otherwise slicing-by-8 tables.
+// Continuation: crc32c(b, n, crc32c(a, m)) == CRC of a followed by b.
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+// CRC of a followed by b from crc_a, crc_b and b's length, without the
+// data: lets a checksum be assembled from separately computed pieces
+uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b);
+
+// The two implementations behind crc32c(), for tests and benchmarks.
+// crc32c_hw() must only be called if crc32c_hw_available().
+bool crc32c_hw_available();
+uint32_t crc32c_hw(const void* data, size_t len, uint32_t crc = 0);
+uint32_t crc32c_sw(const void* data, size_t len, uint32_t crc = 0);
+
+// How much of the traffic it receives a peer checks against
+// PacketHeader::crc32 (frames sent with crc32 == 0 carry no checksum and
+// are never checked)
+enum class CrcVerify : int {
+    Off,
+    Sample,  // One checksummed frame in kCrcSampleInterval
+    All
+};
+
+const uint32_t kCrcSampleInterval = 16;
+
+// "off" / "sample" / "all"; false for anything else
+bool crc_verify_from_name(const std::string& name, CrcVerify& mode);
+
+// Receive-side checksum policy of one connection. Thread-safe, so the
+// mode can be changed while frames are checked.
+class FrameVerifier {
+public:
+    explicit FrameVerifier(CrcVerify initial = CrcVerify::Off) : mode_(static_cast<int>(initial)), seen(0) {}
+
+    CrcVerify mode() const { return static_cast<CrcVerify>(mode_.load(std::memory_order_relaxed)); }
+    void set_mode(CrcVerify mode) { mode_.store(static_cast<int>(mode), std::memory_order_relaxed); }
+
+    // False if the mode picks this frame and its body does not match crc
+    bool check(uint32_t crc, const void* body, size_t len) {
+        CrcVerify current = mode();
+        if (crc == 0 || current == CrcVerify::Off) return true;
+        if (current == CrcVerify::Sample &&
+            seen.fetch_add(1, std::memory_order_relaxed) % kCrcSampleInterval != 0) {
+            return true;
+        }
+        return crc32c(body, len) == crc;
+    }
+
+private:
+    std::atomic<int> mode_;
+    std::atomic<uint32_t> seen;  // Checksummed frames so far (Sample)
+};
+
+#endif // CRC32C_H
@@ -0,0 +1,169 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <list>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+
+// An open file of the storage directory, shared by the cache and every
+// transfer reading it. The fd is closed when the last holder lets go, so an
+// evicted or invalidated entry stays readable for downloads in flight.
+struct CachedFile {
+    int fd;
+    std::string name;
+    off_t size;
+    // Whole content for small files (null otherwise): those are answered
+    // from memory, all frames in one sendmsg
+    std::shared_ptr<const std::string> content;
+
+    CachedFile(int file_fd, const std::string& file_name, off_t file_size)
+        : fd(file_fd), name(file_name), size(file_size) {}
+    ~CachedFile();
+
+    CachedFile(const CachedFile&) = delete;
+    CachedFile& operator=(const CachedFile&) = delete;
+
+    // CRC32C of len bytes at offset, for the checksum of a MSG_FILE_DATA
+    // chunk that is itself sent with sendfile. Whole kCrcBlock-aligned
+    // blocks are read and checksummed once per cached file and remembered;
+    // only the unaligned ends of a range are read each time. False if the
+    // file cannot be read (e.g. truncated). Thread-safe.
+    bool range_crc(off_t offset, size_t len, uint32_t& crc) const;
+
+    // Same, for the event loops: never waits for the disk. Whole blocks come
+    // only from the remembered CRCs, the unaligned ends only if the page
+    // cache has them (RWF_NOWAIT). False if anything is missing; warm_crcs()
+    // on a worker then fills the blocks in.
+    bool cached_range_crc(off_t offset, size_t len, uint32_t& crc) const;
+
+    // Reads and remembers the CRCs of the blocks overlapping [offset,
+    // offset + len) that are not known yet. Blocking: run it off the loops.
+    void warm_crcs(off_t offset, size_t len) const;
+
+    static const size_t kCrcBlock = 64 * 1024;
+
+private:
+    // Per block: CRC in the low 32 bits, bit 32 set once known. Filled
+    // lazily and racily: threads that compute the same block store the same value.
+    mutable std::once_flag crc_once;
+    mutable std::unique_ptr<std::atomic<uint64_t>[]> block_crcs;
+
+    std::atomic<uint64_t>* crc_table() const;
+    bool combine_crc(off_t offset, size_t len, uint32_t& crc, bool nowait) const;
+};
+
+using CachedFilePtr = std::shared_ptr<const CachedFile>;
+
+// LRU cache of open fds + stat data (and content of small files) for the
+// download directory. Hot files skip open()/fstat() entirely.
+// A second LRU, bounded by its own memory limit, keeps compressed copies of
+// the file ranges sent to FEATURE_LZ4 clients, so the chunks of hot files
+// are compressed once.
+// Entries are invalidated by inotify: the owner registers notify_fd() with
+// an event loop and calls process_events() when it is readable. Without
+// inotify every hit is revalidated with one stat() instead.
+// Thread-safe.
+class FileCache {
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t invalidations;
+        size_t entries;
+        size_t memory_bytes;  // Cached small-file content
+        uint64_t compressed_hits;
+        uint64_t compressed_misses;
+        size_t compressed_bytes;  // Cached compressed ranges
+    };
+
+    FileCache(const std::string& dir, size_t max_entries, size_t max_memory, size_t small_file_limit,
+              size_t max_compressed = 0);
+    ~FileCache();
+
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    // Open file for name (a plain name inside dir). Null if it cannot be
+    // opened or is not a regular file; error then says why.
+    CachedFilePtr acquire(const std::string& name, std::string& error);
+
+    // LZ4 block of len bytes at offset of file, for a MSG_FILE_DATA sent
+    // with FRAME_FLAG_LZ4. Compressed on first use and kept (up to
+    // max_compressed bytes, least recently used out first). Null if the
+    // range does not shrink (remembered too) or cannot be read.
+    std::shared_ptr<const std::string> compressed_range(const CachedFilePtr& file, off_t offset, size_t len);
+    // compressed_range() without the read and compression, for callers that
+    // must not block: true if the range is cached, packed then being its
+    // LZ4 block (null if it does not shrink). A false does not count as a miss.
+    bool cached_compressed_range(const CachedFilePtr& file, off_t offset, size_t len,
+                                 std::shared_ptr<const std::string>& packed);
+
+    // inotify descriptor to watch for readability (-1 if unavailable)
+    int notify_fd() const { return inotify_fd; }
+    // Drains pending inotify events and drops the entries they name.
+    // Not thread-safe with itself: call from one loop only.
+    void process_events();
+
+    Stats stats();
+
+private:
+    struct Entry {
+        CachedFilePtr file;
+        dev_t dev;
+        ino_t ino;
+        struct timespec mtime;
+        std::list<std::string>::iterator lru_pos;
+    };
+
+    // A compressed range, keyed by file object: a file that changed on disk
+    // is a new CachedFile, so its old ranges are never served
+    struct RangeKey {
+        const CachedFile* file;
+        off_t offset;
+        size_t len;
+        bool operator==(const RangeKey& other) const {
+            return file == other.file && offset == other.offset && len == other.len;
+        }
+    };
+    struct RangeKeyHash {
+        size_t operator()(const RangeKey& key) const {
+            return std::hash<const void*>()(key.file) ^ std::hash<uint64_t>()((uint64_t)key.offset * 31 + key.len);
+        }
+    };
+    struct Range {
+        std::weak_ptr<const CachedFile> file;  // Expired (or another object) = the address was reused
+        std::shared_ptr<const std::string> data;  // Empty = does not shrink
+        std::list<RangeKey>::iterator lru_pos;
+    };
+
+    std::string dir;
+    size_t max_entries;
+    size_t max_memory;
+    size_t small_file_limit;
+    size_t max_compressed;
+    int inotify_fd;
+
+    std::mutex mutex;
+    bool watching;  // inotify watch on dir is live; otherwise hits are stat()ed
+    uint64_t generation;  // Bumped by every inotify event batch
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;  // Front = most recently used
+    std::unordered_map<RangeKey, Range, RangeKeyHash> ranges;
+    std::list<RangeKey> range_lru;  // Front = most recently used
+    Stats counters;
+
+    bool still_valid(const std::string& path, const Entry& entry);
+    void erase(std::unordered_map<std::string, Entry>::iterator it);  // Caller holds mutex
+    void enforce_limits();                                             // Caller holds mutex
+    void erase_range(std::unordered_map<RangeKey, Range, RangeKeyHash>::iterator it); // Caller holds mutex
+};
+
+#endif // FILE_CACHE_H
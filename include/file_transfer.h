@@ -1,12 +1,72 @@
 #ifndef FILE_TRANSFER_H
 #define FILE_TRANSFER_H
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <sys/types.h>
+#include "protocol.h"
+#include "file_cache.h"
+
+// One download in progress on a connection.
+// A worker creates it (validates the name, gets the open file from the
+// FileCache); from
+// then on only the owning EventLoop touches it. The loop announces it with
+// MSG_FILE_START, streams it as MSG_FILE_DATA chunks sent with sendfile()
+// (io_uring backend: spliced through a pipe) whenever the socket is
+// writable, and closes it with MSG_FILE_END.
+// Queued chat frames go out between chunks. For a compressed job, chunks
+// that shrink go out as plain MSG_FILE_DATA frames instead, built from the
+// FileCache's compressed copy of the range once a worker has made it.
+struct FileJob {
+    static const size_t kPrefixSize = sizeof(PacketHeader) + sizeof(FileChunkHeader);
+
+    CachedFilePtr file;         // Keeps the fd open while the job lives
+    std::string name;
+    off_t size;                 // Whole file
+    off_t start;                // Requested range [start, end)
+    off_t end;
+    off_t offset;               // Next file byte to go into a chunk
+    uint32_t transfer_id;
+    char chunk_prefix[kPrefixSize]; // PacketHeader + FileChunkHeader of the current chunk
+    size_t prefix_sent;         // Bytes of chunk_prefix written (0 = between chunks)
+    size_t chunk_left;          // File bytes of the current chunk still to send
+    int pipe_fds[2];            // io_uring backend: splice pipe (file -> pipe -> socket)
+    bool compress;              // Client asked for FEATURE_LZ4 (set before the job is queued)
+    off_t crc_warm_end;         // Block CRCs handed to a worker up to here (0 = none yet)
+    off_t compress_warm_end;    // Chunks handed to a worker for compression up to here
+    std::atomic<int>* active;   // Transfer slot released on destruction (may be null)
+
+    FileJob(const CachedFilePtr& cached, off_t range_start, off_t range_end);
+    ~FileJob();
+
+    FileJob(const FileJob&) = delete;
+    FileJob& operator=(const FileJob&) = delete;
+
+    bool in_chunk() const { return prefix_sent > 0; }
+    // Length of the chunk at offset, at most max_len. Compressed jobs cut
+    // chunks at multiples of max_len in the file, so the same ranges recur
+    // across downloads and their compressed copies are reused.
+    size_t next_chunk_len(size_t max_len) const;
+    // Fills chunk_prefix for len bytes at chunk_offset and sets chunk_left.
+    // The checksum only uses CRCs the file has without touching the disk;
+    // false if they were missing and the chunk goes out unverified (crc32 0).
+    bool begin_chunk(off_t chunk_offset, size_t len);
+};
+
+using FileJobPtr = std::shared_ptr<FileJob>;
 
 class FileTransfer {
 public:
-    // Handles the file request: Checks existence, sends header, streams content via sendfile
-    static void handle_file_request(int client_fd, const std::string& filename);
+    // Directory downloads are served from
+    static const char* const kStorageDir;
+
+    // Prepares a download of length bytes of filename from offset (0 = to
+    // the end), opening the file through cache. Only plain names of regular
+    // files are accepted, and offset must lie within the file; on failure
+    // returns null and sets error to a message for the client.
+    static FileJobPtr open_job(FileCache& cache, const std::string& filename, uint64_t offset, uint64_t length,
+                               std::string& error);
 };
 
 #endif // FILE_TRANSFER_H
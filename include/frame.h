@@ -0,0 +1,78 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "protocol.h"
+#include "crc32c.h"
+#include "compression.h"
+#include "timing_wheel.h"
+
+// Immutable, refcounted outbound frame. It is serialized once and then shared
+// by every recipient's outbound queue, so a broadcast to N users costs N
+// pointer pushes instead of N buffer builds. Header and payload live in
+// separate fields and are written together with one gathering sendmsg().
+struct OutFrame {
+    PacketHeader header;
+    std::string payload;
+    // Shared buffer sent right after payload as its own iovec (null for most
+    // frames): lets a file chunk reference the FileCache's compressed copy
+    // instead of copying it into every frame
+    std::shared_ptr<const std::string> tail;
+    int64_t created_ns = 0;  // monotonic_ns() when built (STAGE_WRITE starts here)
+
+    size_t tail_size() const { return tail ? tail->size() : 0; }
+    size_t size() const { return sizeof(PacketHeader) + payload.size() + tail_size(); }
+
+    // FRAME_FLAG_LZ4 form of this frame, for connections that negotiated
+    // it. Built by the first such recipient and shared by the others like
+    // the frame itself, so a broadcast is compressed once. Null if it would
+    // not be smaller, and always for frames with a tail. Thread-safe.
+    std::shared_ptr<const OutFrame> compressed() const;
+
+private:
+    mutable std::once_flag lz4_once;
+    mutable std::shared_ptr<const OutFrame> lz4;
+};
+
+using FramePtr = std::shared_ptr<const OutFrame>;
+
+inline FramePtr make_frame(int32_t msg_type, std::string payload, int64_t created_ns = 0) {
+    auto frame = std::make_shared<OutFrame>();
+    frame->created_ns = created_ns ? created_ns : monotonic_ns();
+    frame->header.total_len = sizeof(PacketHeader) + payload.size();
+    frame->header.msg_type = msg_type;
+    frame->payload = std::move(payload);
+    // Once per frame, however many recipients share it
+    frame->header.crc32 = static_cast<int32_t>(crc32c(frame->payload.data(), frame->payload.size()));
+    return frame;
+}
+
+// Frame whose body is payload followed by the bytes of tail, which is
+// referenced rather than copied
+inline FramePtr make_frame(int32_t msg_type, std::string payload, std::shared_ptr<const std::string> tail) {
+    auto frame = std::make_shared<OutFrame>();
+    frame->created_ns = monotonic_ns();
+    frame->header.total_len = sizeof(PacketHeader) + payload.size() + tail->size();
+    frame->header.msg_type = msg_type;
+    uint32_t crc = crc32c(payload.data(), payload.size());
+    frame->header.crc32 = static_cast<int32_t>(crc32c(tail->data(), tail->size(), crc));
+    frame->payload = std::move(payload);
+    frame->tail = std::move(tail);
+    return frame;
+}
+
+inline FramePtr OutFrame::compressed() const {
+    std::call_once(lz4_once, [this] {
+        if (tail) return;
+        uint32_t raw_size = static_cast<uint32_t>(payload.size());
+        std::string body(reinterpret_cast<const char*>(&raw_size), sizeof(raw_size));
+        if (compress_block(payload.data(), payload.size(), body) && body.size() < payload.size()) {
+            lz4 = make_frame(header.msg_type | FRAME_FLAG_LZ4, std::move(body), created_ns);
+        }
+    });
+    return lz4;
+}
+
+#endif // FRAME_H
@@ -0,0 +1,92 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear histogram of non-negative values (HdrHistogram's bucket
+// layout): values below 2 * kSubBuckets are counted exactly, larger ones
+// in kSubBuckets buckets per power of two, so any recorded value is known
+// to within 1/kSubBuckets (~3%) over the whole 64-bit range, in a fixed
+// 15 KB. Recording takes a few relaxed atomic operations, lock-free and
+// safe from any thread; readers get an approximate snapshot without
+// stopping writers.
+class Histogram {
+public:
+    static const int kSubBits = 5;
+    static const uint64_t kSubBuckets = 1 << kSubBits;
+    static const size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    Histogram() { reset(); }
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void record(uint64_t value) {
+        buckets[index_of(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        uint64_t seen = largest.load(std::memory_order_relaxed);
+        while (value > seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+
+    // Smallest recorded value v such that a fraction q (0..1) of the
+    // samples are <= v, as the top of its bucket (capped at max()). 0 if empty.
+    uint64_t percentile(double q) const {
+        uint64_t n = count();
+        if (n == 0) return 0;
+        uint64_t rank = q <= 0 ? 1 : (uint64_t)(q * n + 0.999999);
+        if (rank > n) rank = n;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                uint64_t top = highest_in(i);
+                return top < max() ? top : max();
+            }
+        }
+        return max();
+    }
+
+    // Adds other's samples to this one
+    void merge(const Histogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            uint64_t n = other.buckets[i].load(std::memory_order_relaxed);
+            if (n) buckets[i].fetch_add(n, std::memory_order_relaxed);
+        }
+        total.fetch_add(other.count(), std::memory_order_relaxed);
+        uint64_t value = other.max();
+        uint64_t seen = largest.load(std::memory_order_relaxed);
+        while (value > seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+
+    void reset() {
+        for (size_t i = 0; i < kBuckets; ++i) buckets[i].store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        largest.store(0, std::memory_order_relaxed);
+    }
+
+    static size_t index_of(uint64_t value) {
+        if (value < 2 * kSubBuckets) return (size_t)value;
+        int shift = 63 - __builtin_clzll(value) - kSubBits;
+        return (size_t)shift * kSubBuckets + (size_t)(value >> shift);
+    }
+
+    // Largest value that lands in bucket index
+    static uint64_t highest_in(size_t index) {
+        if (index < 2 * kSubBuckets) return index;
+        int shift = (int)(index / kSubBuckets) - 1;
+        uint64_t top = index % kSubBuckets + kSubBuckets;
+        return ((top + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> buckets[kBuckets];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> largest;
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,93 @@
+#ifndef INLINE_TASK_H
+#define INLINE_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only `void()` callable with fixed inline storage.
+// Unlike std::function it never allocates: the callable is constructed
+// directly inside the object (and therefore inside the ThreadPool ring slot
+// that holds it). Callables larger than kCapacity are rejected at compile
+// time instead of silently spilling to the heap.
+class InlineTask {
+public:
+    static const size_t kCapacity = 104;  // sizeof(InlineTask) == 112 with the ops pointer
+
+    InlineTask() noexcept : ops(nullptr) {}
+
+    template <typename F, typename Fn = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<Fn, InlineTask>::value>::type>
+    InlineTask(F&& f) : ops(&OpsFor<Fn>::table) {
+        static_assert(sizeof(Fn) <= kCapacity, "callable too large for InlineTask; capture less");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "callable over-aligned for InlineTask");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value, "callable must be nothrow movable");
+        new (storage) Fn(std::forward<F>(f));
+    }
+
+    InlineTask(InlineTask&& other) noexcept : ops(other.ops) {
+        if (ops) {
+            ops->move(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+
+    InlineTask& operator=(InlineTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ops = other.ops;
+            if (ops) {
+                ops->move(storage, other.storage);
+                other.ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InlineTask(const InlineTask&) = delete;
+    InlineTask& operator=(const InlineTask&) = delete;
+
+    ~InlineTask() { reset(); }
+
+    void operator()() { ops->invoke(storage); }
+    explicit operator bool() const { return ops != nullptr; }
+
+    // Destroys the held callable (and whatever it captured)
+    void reset() {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src);  // Move-constructs dst, destroys src
+        void (*destroy)(void*);
+    };
+
+    template <typename Fn>
+    struct OpsFor {
+        static void invoke(void* p) { (*static_cast<Fn*>(p))(); }
+        static void move(void* dst, void* src) {
+            new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        }
+        static void destroy(void* p) { static_cast<Fn*>(p)->~Fn(); }
+        static const Ops table;
+    };
+
+    alignas(std::max_align_t) unsigned char storage[kCapacity];
+    const Ops* ops;
+};
+
+template <typename Fn>
+const InlineTask::Ops InlineTask::OpsFor<Fn>::table = {
+    &InlineTask::OpsFor<Fn>::invoke,
+    &InlineTask::OpsFor<Fn>::move,
+    &InlineTask::OpsFor<Fn>::destroy,
+};
+
+#endif // INLINE_TASK_H
@@ -1,43 +1,95 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include <iostream>
-#include <string>
+#include <atomic>
+#include <cstdint>
 #include <mutex>
-#include <chrono>
-#include <iomanip>
+#include <string>
+#include <thread>
+#include "mpmc_queue.h"
 
+// Ordered by severity: the runtime filter drops everything below the minimum
 enum LogLevel {
+    DEBUG,
     INFO,
     WARNING,
-    ERROR,
-    DEBUG
+    ERROR
 };
 
-inline void log_message(LogLevel level, const std::string& message) {
-    static std::mutex log_mutex;
-    std::lock_guard<std::mutex> lock(log_mutex);
+// Asynchronous logger.
+// Callers only stamp the time and copy the message into a fixed-size record
+// of a lock-free ring; they never lock, format or touch the output. A
+// background thread drains the ring, formats the timestamp (cached per
+// second, localtime_r) and emits the lines in large write() calls.
+// When the ring is full the record is dropped and counted; the writer
+// reports the count instead of making callers wait.
+class Logger {
+public:
+    static const size_t kRingCapacity = 8192;
+    static const size_t kMaxMessage = 480;  // Longer messages are truncated
 
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
+    static Logger& instance();
 
-    std::cout << "[" << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S") << "] ";
-
-    switch (level) {
-        case INFO:    std::cout << "[INFO] "; break;
-        case WARNING: std::cout << "[WARNING] "; break;
-        case ERROR:   std::cerr << "[ERROR] "; break;
-        case DEBUG:   std::cout << "[DEBUG] "; break;
+    // Cheap check the LOG_* macros make before building their message
+    static bool enabled(LogLevel level) {
+        return level >= min_level.load(std::memory_order_relaxed);
     }
+    static void set_level(LogLevel level) { min_level.store(level, std::memory_order_relaxed); }
+    static bool parse_level(const std::string& name, LogLevel& level);
 
-    if (level == ERROR) {
-        std::cerr << message << std::endl;
-    } else {
-        std::cout << message << std::endl;
-    }
-}
+    // Redirects output to path (appending); false if it cannot be opened.
+    // The default is stdout.
+    bool set_output(const std::string& path);
+
+    void log(LogLevel level, const std::string& message);
+    // Writes out everything logged so far (also runs at exit)
+    void flush();
+
+    uint64_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    struct Record {
+        int64_t time_ms;  // Wall clock
+        LogLevel level;
+        uint32_t len;
+        char text[kMaxMessage];
+    };
+
+    static std::atomic<int> min_level;
+
+    MpmcQueue<Record> ring;
+    std::atomic<uint64_t> dropped_count;
+    std::atomic<int> output_fd;
+    std::thread writer;
+
+    // Writer side: only one drain at a time (writer thread or flush())
+    std::mutex drain_mutex;
+    std::string batch;  // Lines waiting for the next write()
+    uint64_t reported_drops;
+    int64_t cached_second;
+    char cached_stamp[32];
+
+    Logger();
+    ~Logger() = delete;  // Leaked on purpose: usable from any static destructor
+
+    void writer_loop();
+    bool drain();  // Caller holds drain_mutex; true if anything was written
+    void append_line(int64_t time_ms, LogLevel level, const char* text, size_t len);
+};
+
+#define LOG_AT(level, msg) \
+    do { if (Logger::enabled(level)) Logger::instance().log(level, msg); } while (0)
+
+#define LOG_INFO(msg) LOG_AT(INFO, msg)
+#define LOG_WARNING(msg) LOG_AT(WARNING, msg)
+#define LOG_ERROR(msg) LOG_AT(ERROR, msg)
 
-#define LOG_INFO(msg) log_message(INFO, msg)
-#define LOG_ERROR(msg) log_message(ERROR, msg)
+// Debug logging is compiled out (the message is not even evaluated) unless
+// built with -DLOG_ENABLE_DEBUG
+#ifdef LOG_ENABLE_DEBUG
+#define LOG_DEBUG(msg) LOG_AT(DEBUG, msg)
+#else
+#define LOG_DEBUG(msg) do { } while (0)
+#endif
 
 #endif // LOGGER_H
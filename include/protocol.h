@@ -1,9 +1,12 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 #include <string>
+#include <string_view>
 
 // Message Types
 enum MsgType : int32_t {
@@ -11,19 +14,37 @@ enum MsgType : int32_t {
     MSG_CHAT_PUBLIC = 0x02, // Public Chat
     MSG_CHAT_PRIVATE= 0x03, // Private Chat
     MSG_FILE_REQ    = 0x04, // File Download Request
-    MSG_FILE_DATA   = 0x05, // File Data Stream
+    MSG_FILE_DATA   = 0x05, // File Data Chunk (FileChunkHeader + bytes)
     MSG_HEARTBEAT   = 0x06, // Heartbeat
+    MSG_FILE_START  = 0x07, // File Transfer Start (FileStartBody)
+    MSG_FILE_END    = 0x08, // File Transfer End (FileEndBody)
     
     // Server Responses
     MSG_LOGIN_ACK   = 0x11, 
     MSG_ERROR       = 0xFF
 };
 
+// msg_type carries the MsgType in its low 16 bits and per-frame flags above
+const int32_t kMsgTypeMask = 0xFFFF;
+
+enum FrameFlag : int32_t {
+    // Body uses the compact (v2) encoding below instead of the fixed structs.
+    // On MSG_LOGIN_ACK: the server accepted FEATURE_COMPACT_BODIES.
+    FRAME_FLAG_COMPACT = 0x10000,
+    // Body is LZ4-compressed (compression.h); sent only to peers that asked
+    // with FEATURE_LZ4, and only when it shrinks the body. The body is the
+    // uint32_t size of the original body + the LZ4 block of it; for
+    // MSG_FILE_DATA the FileChunkHeader stays uncompressed in front and the
+    // block holds its length bytes of file data. crc32 covers the body as sent.
+    // On MSG_LOGIN_ACK: the server accepted FEATURE_LZ4.
+    FRAME_FLAG_LZ4 = 0x20000
+};
+
 // Fixed Header (12 bytes)
 struct PacketHeader {
     int32_t total_len;  // Total length (Header + Body)
-    int32_t msg_type;   // MsgType
-    int32_t crc32;      // CRC32 Checksum (0 for now)
+    int32_t msg_type;   // MsgType | FrameFlag bits
+    int32_t crc32;      // CRC32C of the body (crc32c.h); 0 = not computed, never checked
 };
 
 // Body Structures (Helpers for serialization)
@@ -31,6 +52,22 @@ struct LoginBody {
     char username[32]; 
 };
 
+// Optional uint32_t after a v1 LoginBody (or after the compact username):
+// features the client can speak. The server sets the matching FrameFlag on
+// its MSG_LOGIN_ACK for those it accepts; old servers ignore the extra bytes.
+enum LoginFeature : uint32_t {
+    FEATURE_COMPACT_BODIES = 0x1,
+    // Ask the server to check the checksums of this connection's frames
+    // (CrcVerify::Sample / All; never below the server's own setting)
+    FEATURE_VERIFY_SAMPLE = 0x2,
+    FEATURE_VERIFY_ALL = 0x4,
+    // Server -> client bodies may come compressed (FRAME_FLAG_LZ4)
+    FEATURE_LZ4 = 0x8
+};
+
+// Longest username either encoding accepts (what fits LoginBody)
+const size_t kMaxUsername = sizeof(LoginBody::username) - 1;
+
 struct ChatBody {
     char target_user[32]; // Empty for public chat
     char content[1024];   // Fixed size for simplicity in Phase 3
@@ -40,4 +77,93 @@ struct FileReqBody {
     char filename[256];
 };
 
+// Ranged form of MSG_FILE_REQ (longer body; the plain FileReqBody still
+// requests the whole file). length 0 means "to the end of the file".
+// May be followed by a uint32_t of LoginFeature bits (FEATURE_LZ4 only), as
+// download connections do not log in.
+struct FileRangeReqBody {
+    char filename[256];
+    uint64_t offset;
+    uint64_t length;
+};
+
+// File download, server -> client:
+//   MSG_FILE_START, then MSG_FILE_DATA chunks in offset order, then MSG_FILE_END.
+// Frames of one transfer share transfer_id; other frames (chat, other
+// transfers) may arrive in between. The file size is 64-bit, each frame
+// stays small, so total_len never overflows.
+struct FileStartBody {
+    uint64_t file_size;
+    uint64_t range_offset;  // First byte sent
+    uint64_t range_length;  // Bytes that will be sent
+    uint32_t transfer_id;
+    uint32_t chunk_size;  // Size of every MSG_FILE_DATA chunk except the last
+                          // (compressed transfers: chunks end at multiples
+                          // of it in the file, so the first may be shorter)
+    char filename[256];
+};
+
+// Prefix of every MSG_FILE_DATA body; length bytes of file data follow
+struct FileChunkHeader {
+    uint64_t offset;      // Position of the data in the file
+    uint32_t transfer_id;
+    uint32_t length;
+};
+
+struct FileEndBody {
+    uint64_t bytes_sent;  // Of the requested range
+    uint32_t transfer_id;
+    int32_t status;       // 0 = complete
+};
+
+// Compact (v2) bodies, sent with FRAME_FLAG_COMPACT:
+//   field  = varint length (LEB128, 7 bits per byte) + bytes, no padding
+//   login  = field(username) [uint32_t features]
+//   chat   = field(target_user) field(content)   (empty target for public)
+// A public "hi" is 4 bytes instead of the 1056 of ChatBody.
+const size_t kMaxCompactChat = 64 * 1024;  // Longest content the server relays
+
+inline void compact_put(std::string& out, std::string_view field) {
+    size_t len = field.size();
+    while (len >= 0x80) {
+        out += static_cast<char>((len & 0x7F) | 0x80);
+        len >>= 7;
+    }
+    out += static_cast<char>(len);
+    out.append(field.data(), field.size());
+}
+
+// Decodes compact fields in place: the views point into the body
+class CompactReader {
+public:
+    CompactReader(const char* data, size_t size) : pos(data), end(data + size) {}
+
+    bool field(std::string_view& out) {
+        uint64_t len = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (pos == end || shift > 28) return false;
+            uint8_t byte = static_cast<uint8_t>(*pos++);
+            len |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        if (len > static_cast<size_t>(end - pos)) return false;
+        out = std::string_view(pos, len);
+        pos += len;
+        return true;
+    }
+
+    bool u32(uint32_t& out) {
+        if (end - pos < (ptrdiff_t)sizeof(out)) return false;
+        memcpy(&out, pos, sizeof(out));
+        pos += sizeof(out);
+        return true;
+    }
+
+    size_t remaining() const { return end - pos; }
+
+private:
+    const char* pos;
+    const char* end;
+};
+
 #endif // PROTOCOL_H
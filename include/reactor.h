@@ -3,6 +3,7 @@
 
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -10,42 +11,231 @@
 #include <stdexcept>
 #include <cstring>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
 #include <functional>
 #include "logger.h"
 #include "threadpool.h"
 #include "connection_mgr.h"
+#include "server_config.h"
+#include "timing_wheel.h"
+#include "file_cache.h"
+#include "uring.h"
+#include "server_stats.h"
+#include "admin_server.h"
 
 // Basic socket wrapper functions
-int create_server_socket(int port, const char* ip = "0.0.0.0");
+int create_server_socket(int port, const char* ip = "0.0.0.0", bool reuse_port = false, int backlog = 128);
 void set_nonblocking(int fd);
 
-class EpollServer {
+class EpollServer;
+
+// One reactor: owns an epoll instance (or an io_uring, see
+// EventBackend), its own listener (SO_REUSEPORT when several loops share
+// the port) and the connections accepted on it.
+// Other threads must not touch its fds directly; they hand work over with
+// queue_in_loop(), which wakes the loop through an eventfd.
+class EventLoop {
 public:
-    EpollServer(ThreadPool* pool);
-    ~EpollServer();
+    EventLoop(EpollServer* server, int index);
+    ~EventLoop();
 
-    void init(int port, const char* ip = "0.0.0.0");
+    void init(int port, const char* ip, bool reuse_port);
     void run();
+    void stop();
+
+    // Thread-safe: runs fn on this loop's thread during its next iteration.
+    void queue_in_loop(std::function<void()> fn);
+
+    // Closes a connection owned by this loop. Must run on the loop thread.
+    void close_connection(const std::shared_ptr<UserContext>& user);
+
+    // Thread-safe: appends a complete frame to user's outbound queue and makes
+    // sure the loop flushes it. Returns false if the frame was not queued
+    // (connection closing or slow-consumer policy triggered).
+    // The frame is shared, never copied: broadcasting it to N users costs N
+    // pointer pushes. Connections that negotiated FEATURE_LZ4 get its
+    // compressed form instead, itself built once and shared.
+    bool send(const std::shared_ptr<UserContext>& user, const FramePtr& frame);
+
+    // Thread-safe: queues a download behind user's pending frames; the loop
+    // streams it in chunks as the socket drains. Returns false if the
+    // server-wide transfer limit is reached.
+    bool send_file(const std::shared_ptr<UserContext>& user, const FileJobPtr& job);
+
+    int index() const { return loop_index; }
+    FileCache& file_cache();
+    const ServerConfig& config() const;
 
 private:
+    EpollServer* server;
+    int loop_index;
     int epoll_fd;
     int listen_fd;
-    ThreadPool* thread_pool;
-    bool running;
-    ConnectionMgr conn_mgr;
-    
+    int wakeup_fd;
+    int timer_fd;
+    int notify_fd;  // FileCache inotify fd, watched by loop 0 only
+    uint32_t trigger_flags;  // EPOLLET on the listener and client fds in edge-triggered mode, else 0
+    std::atomic<bool> running;
+    ServerStats* stats;      // The server's, or null with --stats=off
+
+    // io_uring backend (network_uring.cpp); null when the loop runs on epoll
+    struct UringOp;
+    std::unique_ptr<Uring> ring;
+    // Watch and Accept ops: re-armed for the life of the loop, so they are
+    // owned here and freed with it instead of on completion
+    std::vector<UringOp*> standing_ops;
+
+    // Idle-timeout wheel, ticked by timer_fd on this loop. Heartbeats only
+    // store a timestamp; when an entry fires the connection is either closed
+    // or re-bucketed at its new deadline.
+    TimingWheel<std::weak_ptr<UserContext>> idle_wheel;
+    int64_t wheel_start_ms;
+
+    std::mutex pending_mutex;
+    std::vector<std::function<void()>> pending_functors;
+    // Write coalescing: connections that got output since the last
+    // iteration, flushed once each after the iteration's events, so frames
+    // queued meanwhile share one sendmsg (guarded by pending_mutex). They
+    // are taken together with pending_functors and flushed before those run:
+    // a close queued after a send() never overtakes the frame.
+    std::vector<std::shared_ptr<UserContext>> dirty_users;
+
+    // Output accounting, logged by the timer. wakeups counts the eventfd
+    // writes other threads made to get work done here (loop thread only
+    // for the rest).
+    std::atomic<uint64_t> wakeups;
+    uint64_t frames_written;
+    uint64_t write_calls;
+    uint64_t reported_frames;
+    uint64_t reported_blocks;  // compression_stats().blocks at the last report (loop 0)
+    int64_t last_stats_ms;
+
+    // Connections owned by this loop, indexed by fd. Only touched on the loop
+    // thread, so the per-event lookup needs no lock; ConnectionMgr serves the
+    // cross-thread lookups (names, broadcast, timeouts).
+    std::vector<std::shared_ptr<UserContext>> local_users;
+    std::shared_ptr<UserContext> local_user(int fd) const {
+        return (size_t)fd < local_users.size() ? local_users[fd] : nullptr;
+    }
+
+    // Registers an internal fd (eventfd, timerfd, inotify) for readability
+    void watch_fd(int fd, const char* what);
     // Helper to add file descriptor to epoll
     void add_fd(int fd, uint32_t events);
     // Helper to remove file descriptor from epoll
     void remove_fd(int fd);
-    
+    // Helper to toggle EPOLLOUT interest on a client fd
+    void set_write_interest(const std::shared_ptr<UserContext>& user, bool enable);
+
     // Handlers
+    // Accepts one pending connection (level-triggered) or all of them
+    // (edge-triggered: until EAGAIN, or the edge would be lost)
     void handle_new_connection();
+    void accept_connection(int client_fd, const struct sockaddr_in& client_addr);
     void handle_client_data(int client_fd);
-    
-    // Heartbeat Monitor
-    void heartbeat_monitor();
-    std::thread monitor_thread;
+    // Frames read_buffer and dispatches the complete packets; false if the
+    // connection was closed for a bad frame. read_ns: when the bytes
+    // arrived (monotonic_ns(), 0 without stats)
+    bool dispatch_packets(const std::shared_ptr<UserContext>& user, int64_t read_ns);
+    void handle_client_write(int client_fd);
+    void handle_wakeup();
+    void handle_timer();
+    void schedule_idle_check(const std::shared_ptr<UserContext>& user, int64_t deadline_ms);
+    // Next stretch of a connection's output: iovecs over queued frames, or
+    // the download whose chunk goes next
+    struct OutputBatch {
+        static const int kMaxIov = 128;  // iovecs per sendmsg (header, payload, tail per frame)
+        struct iovec iov[kMaxIov];
+        int iovcnt;
+        bool more;                       // Output remains after this batch
+        FileJobPtr job;
+    };
+    // Fills batch under out_mutex (pinned, if given, collects the frames it
+    // covers). False, with flush_pending cleared, once nothing is left.
+    bool next_output(const std::shared_ptr<UserContext>& user, OutputBatch& batch, std::vector<FramePtr>* pinned);
+    // Drops the written bytes from user's outbound queue
+    void consume_output(const std::shared_ptr<UserContext>& user, size_t written);
+    // Dequeues a completely sent job and queues its MSG_FILE_END
+    void finish_file_job(const std::shared_ptr<UserContext>& user, const FileJobPtr& job);
+    // Compressed jobs, between chunks: queues the next chunk (of at most
+    // max_len bytes) as a FRAME_FLAG_LZ4 frame from the FileCache's
+    // compressed copy. False (nothing queued) if the job is not compressed,
+    // the chunk is too small or does not shrink, or its copy is not cached
+    // yet; a worker is then asked to compress the chunks ahead, and this one
+    // is sent from the file as usual.
+    bool queue_compressed_chunk(const std::shared_ptr<UserContext>& user, const FileJobPtr& job, size_t max_len);
+
+    // Writes as much of user's outbound queue as the socket accepts
+    void flush_output(const std::shared_ptr<UserContext>& user);
+    // Arranges for flush_output(user) on this loop, per the coalescing mode
+    void schedule_flush(const std::shared_ptr<UserContext>& user);
+    void report_output_stats(int64_t now);
+    // job->begin_chunk(), plus the off-loop CRC warm-up: once a chunk went
+    // out unverified, a worker computes the file's block CRCs ahead of the
+    // transfer so the following chunks find them cached
+    void begin_file_chunk(const FileJobPtr& job, off_t chunk_offset, size_t len);
+    // Counts a sendfile()d chunk of job, just completed, as sent output
+    void count_file_chunk(const FileJob& job);
+    // Sends (part of) the next chunk of job; same return convention as sendmsg
+    ssize_t write_file_chunk(const std::shared_ptr<UserContext>& user, const FileJobPtr& job);
+    // Flushes the dirty connections, then runs the queued functors
+    void run_pending_functors();
+
+    // io_uring backend. A null op argument means a new operation; otherwise
+    // the op is resubmitted (multishot operations that ended).
+    bool init_uring();
+    void free_uring_ops();  // Frees standing_ops (the loop is going away)
+    void run_uring();
+    io_uring_sqe* uring_sqe(UringOp* op);
+    bool uring_watch(int fd, UringOp* op = nullptr);
+    bool uring_accept(UringOp* op = nullptr);
+    void uring_recv(const std::shared_ptr<UserContext>& user, UringOp* op = nullptr);
+    void uring_flush(const std::shared_ptr<UserContext>& user);
+    void uring_file_step(const std::shared_ptr<UserContext>& user, const FileJobPtr& job);
+    void handle_file_completion(UringOp* op, int res);
+    void handle_completion(const io_uring_cqe& cqe);
+};
+
+class EpollServer {
+public:
+    EpollServer(ThreadPool* pool, const ServerConfig& config = ServerConfig());
+    ~EpollServer();
+
+    void init(int port, const char* ip = "0.0.0.0");
+    // Runs loop 0 on the calling thread and loops 1..N-1 on their own threads.
+    void run();
+    // Thread-safe: makes every loop leave run() after its current iteration
+    void stop();
+
+    ConnectionMgr& connections() { return conn_mgr; }
+    ThreadPool* pool() { return thread_pool; }
+    const ServerConfig& config() const { return server_config; }
+    FileCache& file_cache() { return files; }
+    ServerStats& stats() { return server_stats; }
+
+    // Answers an admin endpoint command ("stats", "reset", "help")
+    std::string admin_command(const std::string& command);
+
+    // Claims one of the max_file_transfers slots for job and gives it a
+    // transfer id; the slot is released when the job is destroyed
+    bool acquire_transfer_slot(FileJob& job);
+
+private:
+    ThreadPool* thread_pool;
+    ServerConfig server_config;
+    ConnectionMgr conn_mgr;
+    FileCache files;
+    std::atomic<int> active_transfers;
+    std::atomic<uint32_t> next_transfer_id;
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    std::vector<std::thread> loop_threads;
+    ServerStats server_stats;
+    std::unique_ptr<AdminServer> admin;
+
+    std::string stats_report();
 };
 
 #endif // REACTOR_H
@@ -0,0 +1,91 @@
+#ifndef SERIAL_EXECUTOR_H
+#define SERIAL_EXECUTOR_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <exception>
+#include "threadpool.h"
+#include "inline_task.h"
+#include "logger.h"
+
+// Per-connection "strand" on top of the shared ThreadPool.
+// Tasks posted to one executor run one at a time and in post order, so a
+// connection's packets are handled in arrival order and its handlers never
+// run concurrently. The executor is not pinned to a worker: each turn is a
+// normal pool task, and a busy connection gives the worker back after
+// kBatch tasks by re-enqueuing itself, so one hot user cannot monopolize a
+// thread while others wait.
+//
+// Pending tasks sit in a power-of-two ring that only grows, so a steady
+// stream of posts allocates nothing once the ring has reached its size.
+class SerialExecutor : public std::enable_shared_from_this<SerialExecutor> {
+public:
+    static const int kBatch = 32;
+    static const size_t kInitialRing = 8;
+
+    explicit SerialExecutor(ThreadPool* pool) : pool(pool), head(0), count(0), scheduled(false) {}
+
+    void post(InlineTask task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == ring.size()) grow();
+            ring[(head + count) & (ring.size() - 1)] = std::move(task);
+            count++;
+            if (scheduled) return;
+            scheduled = true;
+        }
+        schedule();
+    }
+
+private:
+    ThreadPool* pool;
+    std::mutex mutex;
+    std::vector<InlineTask> ring;  // Pending tasks, guarded by mutex
+    size_t head;
+    size_t count;
+    bool scheduled;  // A turn is queued on or running in the pool
+
+    void grow() {
+        std::vector<InlineTask> bigger(ring.empty() ? kInitialRing : ring.size() * 2);
+        for (size_t i = 0; i < count; ++i) {
+            bigger[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+        }
+        ring.swap(bigger);
+        head = 0;
+    }
+
+    void schedule() {
+        auto self = shared_from_this();
+        pool->post([self]() { self->run_batch(); });
+    }
+
+    void run_batch() {
+        for (int i = 0; i < kBatch; ++i) {
+            InlineTask task;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (count == 0) {
+                    scheduled = false;
+                    return;
+                }
+                task = std::move(ring[head]);
+                head = (head + 1) & (ring.size() - 1);
+                count--;
+            }
+            // Caught here, not by the pool: an escaping exception would leave
+            // scheduled set, and the strand would never run again
+            try {
+                task();
+            } catch (const std::exception& e) {
+                LOG_ERROR("SerialExecutor: task threw: " + std::string(e.what()));
+            } catch (...) {
+                LOG_ERROR("SerialExecutor: task threw an unknown exception");
+            }
+        }
+        // Still busy: yield the worker and continue behind the other queued work
+        schedule();
+    }
+};
+
+#endif // SERIAL_EXECUTOR_H
@@ -0,0 +1,64 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <string>
+#include <cstddef>
+#include "logger.h"
+#include "crc32c.h"
+
+// What to do when a connection's outbound queue exceeds send_high_water
+enum class SlowConsumerPolicy {
+    Drop,       // Discard the new frame, keep the connection
+    Disconnect  // Close the connection
+};
+
+// What to do when a user logs in with a name that is already online
+enum class DuplicateLoginPolicy {
+    KickOld,   // Bind the name to the new connection and close the old one
+    RejectNew  // Keep the old session, answer the new login with MSG_ERROR
+};
+
+// How packets are handed to the ThreadPool
+enum class DispatchMode {
+    Shared,  // Any free worker, no ordering between packets of one connection
+    Serial   // Per-connection SerialExecutor: in-order, never concurrent per connection
+};
+
+// How each EventLoop waits for and performs I/O
+enum class EventBackend {
+    Epoll,   // Readiness (epoll_wait) + one syscall per read/write
+    IoUring  // Completions: multishot accept/recv, batched submissions; falls back to Epoll if unavailable
+};
+
+// Runtime configuration of the server. Filled from command line flags
+// (--key=value) in main_server.cpp; the defaults are those listed in the README.
+struct ServerConfig {
+    int port = 8080;
+    std::string ip = "0.0.0.0";
+    int worker_threads = 4;   // ThreadPool size
+    int reactor_threads = 1;  // Number of epoll loops (each with its own SO_REUSEPORT listener)
+    EventBackend event_backend = EventBackend::Epoll;
+    bool edge_triggered = false;     // epoll: EPOLLET on listener and clients, accept until EAGAIN
+    int listen_backlog = 128;        // listen() queue; the kernel caps it at net.core.somaxconn
+    size_t send_high_water = 4 * 1024 * 1024; // Max unsent bytes queued per connection
+    SlowConsumerPolicy slow_consumer_policy = SlowConsumerPolicy::Drop;
+    DuplicateLoginPolicy duplicate_login_policy = DuplicateLoginPolicy::KickOld;
+    int heartbeat_timeout_sec = 30;  // Close connections silent for this long
+    int timer_tick_ms = 1000;        // Timing wheel tick (timerfd interval)
+    DispatchMode dispatch_mode = DispatchMode::Serial;
+    bool write_coalescing = true;    // Flush each connection once per loop iteration
+    CrcVerify crc_verify = CrcVerify::Off; // Checksums checked on received frames (clients may ask for more)
+    bool compression = true;         // LZ4 bodies (FRAME_FLAG_LZ4) for clients that ask for them
+    size_t compress_min = 512;       // Smaller bodies are never compressed
+    int max_file_transfers = 16;     // Downloads in flight server-wide; more are refused
+    size_t file_cache_entries = 256;             // Open files kept by the download cache
+    size_t file_cache_memory = 64 * 1024 * 1024; // Bytes of small-file content kept in memory
+    size_t file_cache_small_file = 64 * 1024;    // Files up to this size are cached in memory
+    size_t file_cache_compressed = 64 * 1024 * 1024; // Bytes of compressed file chunks kept for reuse (0: downloads go out uncompressed)
+    LogLevel log_level = INFO;       // Messages below this level are discarded
+    std::string log_file;            // Empty = stdout
+    bool stats = true;               // Per-stage latency histograms and counters (server_stats.h)
+    std::string admin_socket;        // Unix socket path of the admin/stats endpoint; empty = none
+};
+
+#endif // SERVER_CONFIG_H
@@ -0,0 +1,90 @@
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "histogram.h"
+#include "protocol.h"
+
+// Where a packet's (or an outbound frame's) time goes, in nanoseconds
+enum StatStage {
+    STAGE_READ_TO_FRAME,  // read()/recv completion -> packet framed on the reactor
+    STAGE_QUEUE_WAIT,     // framed and posted -> a worker starts it (pool + SerialExecutor wait)
+    STAGE_HANDLER,        // BusinessLogic::process_packet
+    STAGE_WRITE,          // outbound frame built -> its last byte accepted by the socket
+    kStageCount
+};
+
+// Live server statistics: latency histograms per stage and counters per
+// MsgType, connection and EAGAIN counts.
+// Each thread records into a shard of its own (picked on first use), so
+// reactors and workers never write the same cache lines; a reader merges
+// the shards at report time, without stopping anyone. Everything is relaxed
+// atomics: a report is a consistent-enough snapshot, not an exact cut.
+class ServerStats {
+public:
+    static const int kShards = 32;  // Threads beyond this share shards (still correct)
+    static const int kTypes = 256;  // Counters by msg_type & kMsgTypeMask; larger types count as 0
+
+    struct Shard {
+        Histogram stages[kStageCount];
+        std::atomic<uint64_t> packets_in[kTypes];
+        std::atomic<uint64_t> bytes_in[kTypes];
+        std::atomic<uint64_t> packets_out[kTypes];
+        std::atomic<uint64_t> bytes_out[kTypes];
+        std::atomic<uint64_t> accepted;
+        std::atomic<uint64_t> closed;
+        std::atomic<uint64_t> read_eagain;   // Reads that found the socket drained
+        std::atomic<uint64_t> write_eagain;  // Writes that found the socket full
+    };
+
+    // Totals over all shards
+    struct Snapshot {
+        Histogram stages[kStageCount];
+        uint64_t packets_in[kTypes];
+        uint64_t bytes_in[kTypes];
+        uint64_t packets_out[kTypes];
+        uint64_t bytes_out[kTypes];
+        uint64_t accepted;
+        uint64_t closed;
+        uint64_t read_eagain;
+        uint64_t write_eagain;
+    };
+
+    ServerStats();
+
+    ServerStats(const ServerStats&) = delete;
+    ServerStats& operator=(const ServerStats&) = delete;
+
+    // The calling thread's shard
+    Shard& local();
+
+    void record(StatStage stage, int64_t ns) { local().stages[stage].record(ns > 0 ? (uint64_t)ns : 0); }
+    void count_in(int32_t msg_type, size_t bytes) { count(local().packets_in, local().bytes_in, msg_type, bytes); }
+    void count_out(int32_t msg_type, size_t bytes) { count(local().packets_out, local().bytes_out, msg_type, bytes); }
+    static void bump(std::atomic<uint64_t>& counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+
+    void snapshot(Snapshot& out) const;
+    // Zeroes every shard (the admin "reset" command)
+    void reset();
+
+    int64_t started_ns() const { return start_ns; }
+
+private:
+    std::unique_ptr<Shard[]> shards;
+    int64_t start_ns;
+
+    static void count(std::atomic<uint64_t>* packets, std::atomic<uint64_t>* bytes, int32_t msg_type, size_t len) {
+        int type = msg_type & kMsgTypeMask;
+        if (type >= kTypes) type = 0;
+        packets[type].fetch_add(1, std::memory_order_relaxed);
+        bytes[type].fetch_add(len, std::memory_order_relaxed);
+    }
+};
+
+// Printable name of a MsgType ("CHAT_PUBLIC"), or its number
+std::string msg_type_name(int type);
+
+#endif // SERVER_STATS_H
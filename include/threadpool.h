@@ -2,15 +2,29 @@
 #define THREADPOOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include "mpmc_queue.h"
+#include "inline_task.h"
 
+// Work-stealing thread pool.
+// Each worker owns a lock-free run queue. Tasks submitted from outside the
+// pool (the reactors) are spread round-robin over the queues; tasks submitted
+// by a worker go to its own queue. An idle worker takes from its queue first,
+// then steals from the others starting at a random victim, spins for a short
+// while, and only then parks on a condition variable. Producers touch the
+// park mutex only when some worker is actually asleep.
+//
+// Tasks are stored inline in the ring slots, so post() performs no heap
+// allocation at all. enqueue() additionally allocates the shared state
+// behind the returned future; use it only when the result is needed.
 class ThreadPool {
 public:
     ThreadPool(size_t threads);
@@ -19,13 +33,49 @@ public:
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type>;
 
+    // Fire-and-forget: no future, no allocation. The callable must fit in
+    // InlineTask::kCapacity bytes; an exception escaping it is logged and dropped.
+    template<class F>
+    void post(F&& f);
+
+    // Tasks waiting in the queues (not yet started). A racy snapshot, for
+    // monitoring only.
+    size_t pending() const;
+
 private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop;
+    using Task = InlineTask;
+
+    static const size_t kQueueCapacity = 4096;  // Per worker
+    static const int kSpinRounds = 64;          // Steal attempts before parking
+
+    struct Worker {
+        MpmcQueue<Task> queue;
+        std::thread thread;
+        Worker() : queue(kQueueCapacity) {}
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> next_queue;
+
+    // Used only when every per-worker queue is full
+    std::mutex overflow_mutex;
+    std::deque<Task> overflow;
+    std::atomic<size_t> overflow_size;
+
+    // Parking lot for idle workers
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
+    std::atomic<int> sleepers;
+    int wakeups;  // Pending wake-ups, guarded by park_mutex
+
+    std::atomic<bool> stop;
+
+    void submit(Task task);
+    void worker_loop(size_t index);
+    bool find_task(size_t index, Task& task);
+    bool pop_overflow(Task& task);
+    bool has_work() const;
+    void wake_one();
 };
 
 // Implement enqueue here since it is a template
@@ -33,22 +83,24 @@ template<class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
     using return_type = typename std::result_of<F(Args...)>::type;
 
+    // don't allow enqueueing after stopping the pool
+    if(stop.load(std::memory_order_acquire))
+        throw std::runtime_error("enqueue on stopped ThreadPool");
+
     auto task = std::make_shared<std::packaged_task<return_type()>>(
         std::bind(std::forward<F>(f), std::forward<Args>(args)...)
     );
         
     std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-
-        // don't allow enqueueing after stopping the pool
-        if(stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
-
-        tasks.emplace([task](){ (*task)(); });
-    }
-    condition.notify_one();
+    submit([task](){ (*task)(); });
     return res;
 }
 
+template<class F>
+void ThreadPool::post(F&& f) {
+    if(stop.load(std::memory_order_acquire))
+        throw std::runtime_error("post on stopped ThreadPool");
+    submit(Task(std::forward<F>(f)));
+}
+
 #endif // THREADPOOL_H
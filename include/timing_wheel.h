@@ -0,0 +1,106 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <utility>
+
+// Milliseconds on the monotonic clock (immune to wall-clock jumps)
+inline int64_t monotonic_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Same clock in nanoseconds, for latency measurements (server_stats.h)
+inline int64_t monotonic_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Hierarchical timing wheel (kLevels levels of kSlots slots, as in the Linux
+// kernel timer wheel). Level 0 holds entries due within kSlots ticks, level 1
+// within kSlots^2 ticks, and so on; when a lower level wraps, the matching
+// slot of the level above is cascaded down. Scheduling is O(1), and a tick
+// only touches the entries that fire (plus the amortized cascades).
+// Not thread-safe: each EventLoop owns one and drives it from its timerfd.
+template <typename T>
+class TimingWheel {
+public:
+    static const int kSlotBits = 6;
+    static const int kSlots = 1 << kSlotBits;
+    static const int kLevels = 4;
+
+    TimingWheel() : current(0), count(0) {}
+
+    uint64_t now() const { return current; }
+    size_t size() const { return count; }
+
+    // Fires value once the wheel reaches expire_tick. Past ticks fire on the next tick.
+    void schedule(uint64_t expire_tick, T value) {
+        if (expire_tick <= current) expire_tick = current + 1;
+        place(expire_tick, std::move(value));
+        count++;
+    }
+
+    // Moves the wheel forward by ticks, calling on_expire(T&&) for every entry
+    // that becomes due. on_expire may schedule new entries.
+    template <typename F>
+    void advance(uint64_t ticks, F&& on_expire) {
+        while (ticks-- > 0) {
+            current++;
+            for (int level = 1; level < kLevels; ++level) {
+                uint64_t low_mask = (1ull << (level * kSlotBits)) - 1;
+                if ((current & low_mask) != 0) break;
+                cascade(level, (current >> (level * kSlotBits)) & (kSlots - 1));
+            }
+
+            std::vector<Entry>& slot = slots[0][current & (kSlots - 1)];
+            if (slot.empty()) continue;
+            std::vector<Entry> due;
+            due.swap(slot);
+            count -= due.size();
+            for (auto& entry : due) {
+                on_expire(std::move(entry.value));
+            }
+            // Hand the capacity back to the slot to avoid reallocating it next round
+            if (slot.empty()) {
+                due.clear();
+                slot.swap(due);
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        uint64_t expire;
+        T value;
+    };
+
+    std::vector<Entry> slots[kLevels][kSlots];
+    uint64_t current;
+    size_t count;
+
+    void place(uint64_t expire, T&& value) {
+        uint64_t max_delta = (1ull << (kLevels * kSlotBits)) - 1;
+        if (expire - current > max_delta) expire = current + max_delta;
+
+        uint64_t delta = expire - current;
+        int level = 0;
+        while (level < kLevels - 1 && delta >= (1ull << ((level + 1) * kSlotBits))) {
+            level++;
+        }
+        size_t index = (expire >> (level * kSlotBits)) & (kSlots - 1);
+        slots[level][index].push_back(Entry{expire, std::move(value)});
+    }
+
+    void cascade(int level, size_t index) {
+        std::vector<Entry> entries;
+        entries.swap(slots[level][index]);
+        for (auto& entry : entries) {
+            place(entry.expire, std::move(entry.value));
+        }
+    }
+};
+
+#endif // TIMING_WHEEL_H
@@ -0,0 +1,92 @@
+#ifndef URING_H
+#define URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// Minimal io_uring binding over the raw syscalls (no liburing): one
+// submission/completion queue pair plus one provided-buffer ring that
+// multishot receives pick their buffers from.
+// Not thread-safe: owned and driven by one EventLoop.
+class Uring {
+public:
+    static const uint16_t kBufferGroup = 0;
+
+    Uring();
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    // Kernel has everything the reactor relies on (multishot accept and
+    // receive, provided-buffer rings: Linux 6.0)
+    static bool supported();
+
+    // Sets up a ring of entries SQEs and buffer_count receive buffers of
+    // buffer_size bytes (buffer_count a power of two). False with errno set
+    // if the kernel refuses any of it.
+    bool init(unsigned entries, unsigned buffer_count, unsigned buffer_size);
+
+    // Zeroed SQE for the caller to fill. Submits what is pending first if
+    // the queue is full; null only if even that fails.
+    io_uring_sqe* get_sqe();
+
+    // Submits all pending SQEs and waits for at least wait_nr completions.
+    // Returns io_uring_enter()'s result (-1 with errno on failure).
+    int submit_and_wait(unsigned wait_nr);
+
+    // Calls fn(const io_uring_cqe&) for every completion ready. Each CQE is
+    // copied and released before fn runs, so fn may queue new SQEs.
+    template <typename Fn>
+    unsigned for_each_cqe(Fn fn) {
+        unsigned head = *cq_head;
+        unsigned count = 0;
+        while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = cqes[head & cq_mask];
+            __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+            fn(cqe);
+            count++;
+        }
+        return count;
+    }
+
+    // Receive buffer bid of a CQE carrying IORING_CQE_F_BUFFER
+    char* buffer(uint16_t bid) { return buffers + (size_t)bid * buffer_size; }
+    // Hands a consumed receive buffer back to the kernel
+    void recycle_buffer(uint16_t bid);
+
+    uint64_t enter_calls() const { return enters; }
+
+private:
+    int ring_fd;
+    void* ring_mem;
+    size_t ring_len;
+    io_uring_sqe* sqes;
+    size_t sqes_len;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;  // Next SQE to hand out; published to *sq_tail on submit
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+
+    io_uring_buf_ring* buf_ring;
+    size_t buf_ring_len;
+    char* buffers;
+    size_t buffers_len;
+    unsigned buffer_count;
+    unsigned buffer_size;
+    uint16_t buf_tail;
+
+    uint64_t enters;
+
+    void release();
+};
+
+#endif // URING_H
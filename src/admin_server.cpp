@@ -0,0 +1,110 @@
+#include "../include/admin_server.h"
+#include "../include/logger.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+const size_t kMaxCommand = 256;
+const int kClientTimeoutSec = 2;  // A silent or stuck client cannot hold the thread longer
+
+bool make_address(const std::string& path, struct sockaddr_un& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+}
+
+AdminServer::AdminServer(const std::string& socket_path, Handler fn)
+    : path(socket_path), handler(std::move(fn)), listen_fd(-1), stopping(false) {}
+
+AdminServer::~AdminServer() {
+    stopping = true;
+    if (listen_fd != -1) {
+        // Wakes the blocked accept()
+        shutdown(listen_fd, SHUT_RDWR);
+    }
+    if (thread.joinable()) thread.join();
+    if (listen_fd != -1) {
+        close(listen_fd);
+        unlink(path.c_str());
+    }
+}
+
+bool AdminServer::start() {
+    struct sockaddr_un addr;
+    if (!make_address(path, addr)) {
+        LOG_ERROR("Invalid admin socket path: " + path);
+        return false;
+    }
+
+    // A leftover file from a server that died is replaced; a live one is not
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        bool in_use = connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        close(probe);
+        if (in_use) {
+            LOG_ERROR("Admin socket already in use: " + path);
+            return false;
+        }
+    }
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        LOG_ERROR("Failed to open admin socket " + path + ": " + strerror(errno));
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    listen_fd = fd;
+    thread = std::thread(&AdminServer::serve, this);
+    LOG_INFO("Admin socket listening on " + path);
+    return true;
+}
+
+void AdminServer::serve() {
+    while (!stopping) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (!stopping) LOG_ERROR("Admin socket accept failed: " + std::string(strerror(errno)));
+            return;
+        }
+        answer(fd);
+        close(fd);
+    }
+}
+
+void AdminServer::answer(int fd) {
+    struct timeval timeout;
+    timeout.tv_sec = kClientTimeoutSec;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // One line (or whatever arrives before EOF)
+    std::string command;
+    char buf[kMaxCommand];
+    while (command.size() < kMaxCommand && command.find('\n') == std::string::npos) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        command.append(buf, n);
+    }
+    command = command.substr(0, command.find('\n'));
+    while (!command.empty() && (command.back() == '\r' || command.back() == ' ')) command.pop_back();
+
+    std::string reply = handler(command);
+    size_t sent = 0;
+    while (sent < reply.size()) {
+        ssize_t n = send(fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        sent += n;
+    }
+}
@@ -0,0 +1,56 @@
+#include "../include/block_pool.h"
+#include <new>
+
+BlockPool& BlockPool::instance() {
+    // Leaked on purpose: views may still be released by worker threads
+    // during static destruction
+    static BlockPool* pool = new BlockPool();
+    return *pool;
+}
+
+BlockRef BlockPool::acquire(size_t min_capacity) {
+    int size_class = 0;
+    size_t capacity = kMinBlock;
+    while (capacity < min_capacity && size_class < kClasses - 1) {
+        capacity <<= 1;
+        size_class++;
+    }
+
+    RecvBlock* block = nullptr;
+    if (capacity >= min_capacity) {
+        FreeList& list = free_lists[size_class];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        if (!list.blocks.empty()) {
+            block = list.blocks.back();
+            list.blocks.pop_back();
+        }
+    } else {
+        // Larger than the biggest class: exact size, never cached
+        capacity = min_capacity;
+        size_class = -1;
+    }
+
+    if (!block) {
+        void* mem = ::operator new(sizeof(RecvBlock) + capacity);
+        block = new (mem) RecvBlock();
+        block->capacity = capacity;
+        block->size_class = size_class;
+    }
+    block->refs.store(1, std::memory_order_relaxed);
+    live_blocks.fetch_add(1, std::memory_order_relaxed);
+    return BlockRef(block);
+}
+
+void BlockPool::recycle(RecvBlock* block) {
+    live_blocks.fetch_sub(1, std::memory_order_relaxed);
+    if (block->size_class >= 0) {
+        FreeList& list = free_lists[block->size_class];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        if ((list.blocks.size() + 1) * block->capacity <= kMaxCachedBytes) {
+            list.blocks.push_back(block);
+            return;
+        }
+    }
+    block->~RecvBlock();
+    ::operator delete(block);
+}
@@ -0,0 +1,115 @@
+#include "../include/buffer.h"
+#include <sys/uio.h>
+#include <cstring>
+#include <cerrno>
+
+Buffer::Buffer(size_t first_size)
+    : initial_size(first_size > 0 ? first_size : kInitialSize), read_index(0), write_index(0) {}
+
+PacketView Buffer::view(size_t offset, size_t len) const {
+    PacketView v;
+    v.block = block;
+    v.ptr = peek() + offset;
+    v.len = len;
+    return v;
+}
+
+void Buffer::retrieve(size_t n) {
+    if (n < readable()) {
+        read_index += n;
+    } else {
+        retrieve_all();
+    }
+}
+
+void Buffer::retrieve_all() {
+    // Fully drained: the block goes back to the pool, or stays with the
+    // views still reading it until they are done. The next read takes a
+    // block again, so an idle connection holds none.
+    block.reset();
+    read_index = write_index = 0;
+}
+
+void Buffer::append(const char* data, size_t len) {
+    if (writable() < len) {
+        make_space(len);
+    }
+    memcpy(block.data() + write_index, data, len);
+    write_index += len;
+}
+
+void Buffer::make_space(size_t len) {
+    size_t pending = readable();
+    if (block.unique() && read_index + writable() >= len && read_index >= pending) {
+        // Enough room once the consumed prefix is reclaimed, and the move is
+        // no larger than the space it frees
+        memmove(block.data(), block.data() + read_index, pending);
+    } else {
+        // Shared with views, or too small: continue in a fresh block. Only
+        // the pending partial packet is copied.
+        size_t capacity = block ? block.capacity() : initial_size;
+        if (pending + len > capacity) {
+            capacity *= 2;
+            while (capacity < pending + len) capacity *= 2;
+        }
+        BlockRef fresh = BlockPool::instance().acquire(capacity);
+        if (pending > 0) memcpy(fresh.data(), block.data() + read_index, pending);
+        block = std::move(fresh);
+    }
+    read_index = 0;
+    write_index = pending;
+}
+
+ssize_t Buffer::read_fd(int fd) {
+    // An empty buffer reads straight into a block taken for the call, not
+    // into the stack area (which would cost a copy on nearly every read);
+    // the block goes back if nothing arrives
+    bool borrowed = !block;
+    if (borrowed) block = BlockPool::instance().acquire(initial_size);
+
+    char extra[kExtraReadSize];
+    struct iovec iov[2];
+    size_t tail = writable();
+    iov[0].iov_base = block.data() + write_index;
+    iov[0].iov_len = tail;
+    iov[1].iov_base = extra;
+    iov[1].iov_len = sizeof(extra);
+
+    // Skip the stack area when the tail alone is already large
+    int iovcnt = tail < sizeof(extra) ? 2 : 1;
+    ssize_t n = readv(fd, iov, iovcnt);
+    if (n <= 0) {
+        if (borrowed) {
+            int saved_errno = errno;
+            block.reset();
+            errno = saved_errno;
+        }
+        return n;
+    }
+    if ((size_t)n <= tail) {
+        write_index += n;
+    } else {
+        write_index = block.capacity();
+        int saved_errno = errno;
+        append(extra, n - tail);
+        errno = saved_errno;
+    }
+    return n;
+}
+
+FrameStatus next_packet(Buffer& input, PacketHeader& header, PacketView& body) {
+    if (input.readable() < sizeof(PacketHeader)) return FrameStatus::NeedMore;
+    memcpy(&header, input.peek(), sizeof(PacketHeader));
+
+    // Sanity check on length to prevent OOM
+    if (header.total_len > kMaxPacketLen || header.total_len < (int32_t)sizeof(PacketHeader)) {
+        return FrameStatus::Invalid;
+    }
+    if (input.readable() < (size_t)header.total_len) return FrameStatus::NeedMore;
+
+    // No copy: the worker's reference keeps the bytes alive after the
+    // cursor moves on. Consuming just advances the read cursor.
+    body = input.view(sizeof(PacketHeader), header.total_len - sizeof(PacketHeader));
+    input.retrieve(header.total_len);
+    return FrameStatus::Complete;
+}
@@ -3,31 +3,37 @@
 #include <cstring>
 #include <unistd.h>
 #include <iostream>
-#include <cstring>
-#include <unistd.h>
-#include <iostream>
 #include "../include/file_transfer.h"
-void BusinessLogic::process_packet(std::shared_ptr<UserContext> user, PacketHeader header, std::vector<char> body, ConnectionMgr& conn_mgr) {
+#include "../include/reactor.h"
+
+void BusinessLogic::process_packet(const std::shared_ptr<UserContext>& user, const PacketHeader& header, const PacketView& body, ConnectionMgr& conn_mgr) {
     if (!user) return;
 
-    switch (header.msg_type) {
+    if (!user->verifier.check(header.crc32, body.data(), body.size())) {
+        LOG_WARNING("Checksum mismatch on frame type " + std::to_string(header.msg_type & kMsgTypeMask) +
+                    " from fd " + std::to_string(user->fd) + ", dropped");
+        send_to_user(user, MSG_ERROR, "Checksum mismatch, message dropped");
+        return;
+    }
+
+    bool compact = (header.msg_type & FRAME_FLAG_COMPACT) != 0;
+    switch (header.msg_type & kMsgTypeMask) {
         case MSG_LOGIN:
-            handle_login(user, body, conn_mgr);
+            handle_login(user, body, compact, conn_mgr);
             break;
         case MSG_CHAT_PUBLIC:
-            handle_chat_public(user, body, conn_mgr);
+            handle_chat_public(user, body, compact, conn_mgr);
             break;
         case MSG_CHAT_PRIVATE:
-            handle_chat_private(user, body, conn_mgr);
+            handle_chat_private(user, body, compact, conn_mgr);
             break;
         case MSG_FILE_REQ:
-            if (body.size() >= sizeof(FileReqBody)) {
-                FileReqBody* req = (FileReqBody*)body.data();
-                FileTransfer::handle_file_request(user->fd, std::string(req->filename));
-            }
+            handle_file_request(user, body);
             break;
         case MSG_HEARTBEAT:
-            user->last_heartbeat = time(nullptr);
+            // Just a timestamp store: the owning loop's timing wheel notices
+            // it when the old deadline comes up and re-buckets the connection
+            user->last_heartbeat = monotonic_ms();
             // Optional: Send ACK or just silent update
             break;
         default:
@@ -36,76 +42,170 @@ void BusinessLogic::process_packet(std::shared_ptr<UserContext> user, PacketHead
     }
 }
 
-void BusinessLogic::send_to_fd(int fd, int32_t msg_type, const std::string& data) {
-    PacketHeader header;
-    header.total_len = sizeof(PacketHeader) + data.size();
-    header.msg_type = msg_type;
-    header.crc32 = 0;
+bool BusinessLogic::parse_login(const PacketView& body, bool compact, std::string_view& username, uint32_t& features) {
+    features = 0;
+    if (compact) {
+        CompactReader reader(body.data(), body.size());
+        if (!reader.field(username)) return false;
+        if (reader.remaining() > 0 && !reader.u32(features)) return false;
+        return true;
+    }
 
-    // TODO: Verify if write is thread-safe or if we need a write queue.
-    // For now, raw write on non-blocking socket.
-    
-    // Note: Writing to non-blocking socket in loop until done.
-    // In real reactor, we should register EPOLLOUT if write blocks.
-    // Here simplifying for Phase 3.
-    
-    std::vector<char> packet(header.total_len);
-    memcpy(packet.data(), &header, sizeof(PacketHeader));
-    if (!data.empty()) {
-        memcpy(packet.data() + sizeof(PacketHeader), data.data(), data.size());
-    }
-
-    ssize_t sent = 0;
-    while(sent < header.total_len) {
-        ssize_t ret = write(fd, packet.data() + sent, header.total_len - sent);
-        if (ret < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) continue;
-            LOG_ERROR("Write failed to fd " + std::to_string(fd));
-            break;
+    const LoginBody* login = body.as<LoginBody>();
+    if (!login) return false;
+    username = std::string_view(login->username, strnlen(login->username, sizeof(login->username)));
+    if (body.size() >= sizeof(LoginBody) + sizeof(features)) {
+        memcpy(&features, body.data() + sizeof(LoginBody), sizeof(features));
+    }
+    return true;
+}
+
+bool BusinessLogic::parse_chat(const PacketView& body, bool compact, ChatFields& chat) {
+    if (compact) {
+        CompactReader reader(body.data(), body.size());
+        return reader.field(chat.target) && reader.field(chat.content);
+    }
+
+    const ChatBody* fixed = body.as<ChatBody>();
+    if (!fixed) return false;
+    chat.target = std::string_view(fixed->target_user, strnlen(fixed->target_user, sizeof(fixed->target_user)));
+    chat.content = std::string_view(fixed->content, strnlen(fixed->content, sizeof(fixed->content)));
+    return true;
+}
+
+void BusinessLogic::send_to_user(const std::shared_ptr<UserContext>& user, int32_t msg_type, std::string data) {
+    send_frame(user, make_frame(msg_type, std::move(data)));
+}
+
+void BusinessLogic::send_frame(const std::shared_ptr<UserContext>& user, const FramePtr& frame) {
+    if (!user || !user->loop) return;
+
+    // Frames are never written from worker threads: they go to the
+    // connection's outbound queue and the owning reactor flushes it
+    // (arming EPOLLOUT while the socket is full), so frames cannot
+    // interleave and a slow reader never pins a worker.
+    user->loop->send(user, frame);
+}
+
+void BusinessLogic::handle_file_request(const std::shared_ptr<UserContext>& user, const PacketView& body) {
+    // Ranged request, or the plain form asking for the whole file
+    FileRangeReqBody req;
+    uint32_t features = 0;
+    if (body.copy_to(req)) {
+        if (body.size() >= sizeof(req) + sizeof(features)) {
+            memcpy(&features, body.data() + sizeof(req), sizeof(features));
         }
-        sent += ret;
+    } else {
+        const FileReqBody* plain = body.as<FileReqBody>();
+        if (!plain) return;
+        memcpy(req.filename, plain->filename, sizeof(req.filename));
+        req.offset = 0;
+        req.length = 0;
     }
+
+    // The worker only validates and opens; the owning reactor does the
+    // sending, chunk by chunk, as the socket drains
+    std::string filename(req.filename, strnlen(req.filename, sizeof(req.filename)));
+    std::string error;
+    if (!user->loop) return;
+    FileJobPtr job = FileTransfer::open_job(user->loop->file_cache(), filename, req.offset, req.length, error);
+    if (!job) {
+        send_to_user(user, MSG_ERROR, error);
+        return;
+    }
+    job->compress = user->loop->config().compression && (user->lz4 || (features & FEATURE_LZ4));
+    if (!user->loop->send_file(user, job)) {
+        send_to_user(user, MSG_ERROR, "Too many file transfers in progress, try again later");
+        return;
+    }
+    LOG_INFO("Starting transfer of " + filename + " [" + std::to_string(job->start) + ", " +
+             std::to_string(job->end) + ") to fd " + std::to_string(user->fd));
 }
 
-void BusinessLogic::handle_login(std::shared_ptr<UserContext> user, std::vector<char>& body, ConnectionMgr& conn_mgr) {
-    // Unsafe cast for simplicity (Phase 3)
-    if (body.size() < sizeof(LoginBody)) return;
-    
-    LoginBody* login = (LoginBody*)body.data();
-    user->username = std::string(login->username);
-    
-    LOG_INFO("User logged in: " + user->username + " (fd: " + std::to_string(user->fd) + ")");
+void BusinessLogic::handle_login(const std::shared_ptr<UserContext>& user, const PacketView& body, bool compact, ConnectionMgr& conn_mgr) {
+    std::string_view name;
+    uint32_t features;
+    if (!parse_login(body, compact, name, features)) return;
+
+    if (name.empty()) {
+        send_to_user(user, MSG_ERROR, "Empty username");
+        return;
+    }
+    if (name.size() > kMaxUsername || name.find('\0') != std::string_view::npos) {
+        send_to_user(user, MSG_ERROR, "Invalid username");
+        return;
+    }
+    std::string username(name);
+
+    std::shared_ptr<UserContext> displaced;
+    if (!conn_mgr.bind_username(user, username, displaced)) {
+        LOG_INFO("Rejected duplicate login: " + username + " (fd: " + std::to_string(user->fd) + ")");
+        send_to_user(user, MSG_ERROR, "Username already online: " + username);
+        return;
+    }
+
+    if (displaced && displaced->loop) {
+        LOG_INFO("Kicking previous session of " + username + " (fd: " + std::to_string(displaced->fd) + ")");
+        // The close is queued after the flush handoff, so the notice goes out first
+        send_to_user(displaced, MSG_ERROR, "Logged in from another connection");
+        EventLoop* loop = displaced->loop;
+        loop->queue_in_loop([loop, displaced]() { loop->close_connection(displaced); });
+    }
     
-    send_to_fd(user->fd, MSG_LOGIN_ACK, "Welcome " + user->username);
+    LOG_INFO("User logged in: " + username + " (fd: " + std::to_string(user->fd) + ")");
+
+    // Only ever raised: the server's own setting is the floor
+    CrcVerify asked = (features & FEATURE_VERIFY_ALL) ? CrcVerify::All
+                    : (features & FEATURE_VERIFY_SAMPLE) ? CrcVerify::Sample : CrcVerify::Off;
+    if (asked > user->verifier.mode()) user->verifier.set_mode(asked);
+
+    // A compact login implies the client speaks compact bodies
+    int32_t ack_type = MSG_LOGIN_ACK;
+    if (compact || (features & FEATURE_COMPACT_BODIES)) ack_type |= FRAME_FLAG_COMPACT;
+    if ((features & FEATURE_LZ4) && user->loop && user->loop->config().compression) {
+        user->lz4 = true;
+        ack_type |= FRAME_FLAG_LZ4;
+    }
+    send_to_user(user, ack_type, "Welcome " + username);
 }
 
-void BusinessLogic::handle_chat_public(std::shared_ptr<UserContext> user, std::vector<char>& body, ConnectionMgr& conn_mgr) {
-    if (body.size() < sizeof(ChatBody)) return;
-    ChatBody* chat = (ChatBody*)body.data();
-    
-    std::string msg = "[" + user->username + "]: " + std::string(chat->content);
-    LOG_INFO("Public Chat: " + msg);
+void BusinessLogic::handle_chat_public(const std::shared_ptr<UserContext>& user, const PacketView& body, bool compact, ConnectionMgr& conn_mgr) {
+    ChatFields chat;
+    if (!parse_chat(body, compact, chat)) return;
+    if (chat.content.size() > kMaxCompactChat) {
+        send_to_user(user, MSG_ERROR, "Message too long");
+        return;
+    }
+
+    std::string msg = "[" + user->username + "]: ";
+    msg.append(chat.content);
+    LOG_DEBUG("Public Chat: " + msg);
     
-    auto all_fds = conn_mgr.get_all_fds();
-    for (int fd : all_fds) {
-        if (fd != user->fd) {
-            send_to_fd(fd, MSG_CHAT_PUBLIC, msg);
+    // Serialize once; every recipient queue shares the same frame
+    FramePtr frame = make_frame(MSG_CHAT_PUBLIC, std::move(msg));
+    UserListPtr all_users = conn_mgr.get_all_users();
+    for (const auto& peer : *all_users) {
+        if (peer != user) {
+            send_frame(peer, frame);
         }
     }
 }
 
-void BusinessLogic::handle_chat_private(std::shared_ptr<UserContext> user, std::vector<char>& body, ConnectionMgr& conn_mgr) {
-    if (body.size() < sizeof(ChatBody)) return;
-    ChatBody* chat = (ChatBody*)body.data();
-    
-    std::string target(chat->target_user);
-    std::string content(chat->content);
-    
-    int target_fd = conn_mgr.get_fd_by_username(target);
-    if (target_fd != -1) {
-         std::string msg = "[Private from " + user->username + "]: " + content;
-         send_to_fd(target_fd, MSG_CHAT_PRIVATE, msg);
+void BusinessLogic::handle_chat_private(const std::shared_ptr<UserContext>& user, const PacketView& body, bool compact, ConnectionMgr& conn_mgr) {
+    ChatFields chat;
+    if (!parse_chat(body, compact, chat)) return;
+    if (chat.content.size() > kMaxCompactChat) {
+        send_to_user(user, MSG_ERROR, "Message too long");
+        return;
+    }
+
+    std::string target(chat.target);
+    auto target_user = conn_mgr.get_user_by_username(target);
+    if (target_user) {
+         std::string msg = "[Private from " + user->username + "]: ";
+         msg.append(chat.content);
+         send_to_user(target_user, MSG_CHAT_PRIVATE, std::move(msg));
     } else {
-        send_to_fd(user->fd, MSG_ERROR, "User not found: " + target);
+        send_to_user(user, MSG_ERROR, "User not found: " + target);
     }
 }
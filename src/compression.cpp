@@ -0,0 +1,256 @@
+#include "../include/compression.h"
+#include "../include/protocol.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+// Block format: sequences of
+//   token (literal count << 4 | match length - 4), [literal count - 15 as
+//   255-runs], literals, offset (2 bytes LE), [match length - 19 as 255-runs]
+// The last sequence has literals only. Encoder restrictions of the format:
+// the last 5 bytes are literals and no match starts in the last 12.
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 5;
+static const size_t kMatchStartLimit = 12;
+static const size_t kMaxOffset = 65535;
+static const size_t kMaxInput = 0x7E000000;
+static const int kHashLog = 12;
+
+namespace {
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashLog);
+}
+
+// Equal bytes at a and b, stopping at limit (on b's side)
+inline size_t common_length(const uint8_t* a, const uint8_t* b, const uint8_t* limit) {
+    const uint8_t* start = b;
+    while (b + 8 <= limit) {
+        uint64_t x, y;
+        memcpy(&x, a, 8);
+        memcpy(&y, b, 8);
+        if (uint64_t diff = x ^ y) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return (b - start) + (__builtin_ctzll(diff) >> 3);
+#else
+            return (b - start) + (__builtin_clzll(diff) >> 3);
+#endif
+        }
+        a += 8;
+        b += 8;
+    }
+    while (b < limit && *a == *b) {
+        a++;
+        b++;
+    }
+    return b - start;
+}
+
+inline uint8_t* put_length(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+
+// Extension bytes of a length field that starts at 15 (the token's nibble)
+inline bool get_length(const uint8_t*& ip, const uint8_t* end, size_t& len) {
+    uint8_t byte;
+    do {
+        if (ip == end) return false;
+        byte = *ip++;
+        len += byte;
+    } while (byte == 255);
+    return true;
+}
+
+std::atomic<uint64_t> stat_blocks{0};
+std::atomic<uint64_t> stat_raw{0};
+std::atomic<uint64_t> stat_compressed{0};
+std::atomic<uint64_t> stat_stored{0};
+std::atomic<uint64_t> stat_nanos{0};
+
+}  // namespace
+
+size_t lz4_compress_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+size_t lz4_compress(const void* src, size_t len, char* dst, size_t capacity) {
+    if (len > kMaxInput) return 0;
+    const uint8_t* base = static_cast<const uint8_t*>(src);
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    const uint8_t* end = base + len;
+    uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* op_end = op + capacity;
+
+    if (len > kMatchStartLimit) {
+        const uint8_t* match_start_limit = end - kMatchStartLimit;
+        const uint8_t* match_end_limit = end - kLastLiterals;
+        // Last position seen per hash of 4 bytes; a stale or colliding
+        // entry is caught by comparing the bytes
+        uint32_t table[1 << kHashLog] = {};
+        unsigned misses = 0;
+
+        while (ip < match_start_limit) {
+            uint32_t sequence = read32(ip);
+            uint32_t h = hash4(sequence);
+            const uint8_t* ref = base + table[h];
+            table[h] = static_cast<uint32_t>(ip - base);
+            if (ref >= ip || (size_t)(ip - ref) > kMaxOffset || read32(ref) != sequence) {
+                // Skip faster through data that keeps missing
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            size_t match = kMinMatch + common_length(ref + kMinMatch, ip + kMinMatch, match_end_limit);
+            size_t literals = ip - anchor;
+
+            if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1) return 0;
+            uint8_t* token = op++;
+            if (literals >= 15) {
+                *token = 15 << 4;
+                op = put_length(op, literals - 15);
+            } else {
+                *token = static_cast<uint8_t>(literals << 4);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+            size_t offset = ip - ref;
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            size_t extra = match - kMinMatch;
+            if (extra >= 15) {
+                *token |= 15;
+                op = put_length(op, extra - 15);
+            } else {
+                *token |= static_cast<uint8_t>(extra);
+            }
+
+            ip += match;
+            anchor = ip;
+            // The match's tail is a likely start for the next one
+            if (ip < match_start_limit) table[hash4(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+        }
+    }
+
+    size_t literals = end - anchor;
+    if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals) return 0;
+    if (literals >= 15) {
+        *op++ = 15 << 4;
+        op = put_length(op, literals - 15);
+    } else {
+        *op++ = static_cast<uint8_t>(literals << 4);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+    return op - reinterpret_cast<uint8_t*>(dst);
+}
+
+bool lz4_decompress(const void* src, size_t len, char* dst, size_t raw_len) {
+    const uint8_t* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* end = ip + len;
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* op = out;
+    uint8_t* op_end = out + raw_len;
+
+    for (;;) {
+        if (ip == end) return false;
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(ip, end, literals)) return false;
+        if (literals > (size_t)(end - ip) || literals > (size_t)(op_end - op)) return false;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) return op == op_end;  // Last sequence: literals only
+
+        if (end - ip < 2) return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - out)) return false;
+
+        size_t match = token & 15;
+        if (match == 15 && !get_length(ip, end, match)) return false;
+        match += kMinMatch;
+        if (match > (size_t)(op_end - op)) return false;
+
+        const uint8_t* ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            // Overlapping: the match repeats the last offset bytes
+            for (size_t i = 0; i < match; ++i) *op++ = *ref++;
+        }
+    }
+}
+
+bool compress_block(const void* data, size_t len, std::string& out) {
+    if (len == 0) return false;
+    auto started = std::chrono::steady_clock::now();
+    size_t old_size = out.size();
+    out.resize(old_size + len);
+    size_t packed = lz4_compress(data, len, &out[old_size], len - 1);
+    stat_nanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - started).count(),
+                         std::memory_order_relaxed);
+    stat_blocks.fetch_add(1, std::memory_order_relaxed);
+    if (packed == 0) {
+        out.resize(old_size);
+        stat_stored.fetch_add(len, std::memory_order_relaxed);
+        return false;
+    }
+    out.resize(old_size + packed);
+    stat_raw.fetch_add(len, std::memory_order_relaxed);
+    stat_compressed.fetch_add(packed, std::memory_order_relaxed);
+    return true;
+}
+
+bool expand_frame_body(int32_t msg_type, const char* body, size_t len, size_t max_size, std::vector<char>& out) {
+    // MSG_FILE_DATA keeps its FileChunkHeader, whose length is the raw size;
+    // other bodies start with the raw size
+    size_t prefix;
+    uint32_t raw_size;
+    if ((msg_type & kMsgTypeMask) == MSG_FILE_DATA) {
+        FileChunkHeader chunk;
+        if (len < sizeof(chunk)) return false;
+        memcpy(&chunk, body, sizeof(chunk));
+        prefix = sizeof(chunk);
+        raw_size = chunk.length;
+        out.assign(body, body + prefix);
+    } else {
+        if (len < sizeof(raw_size)) return false;
+        memcpy(&raw_size, body, sizeof(raw_size));
+        prefix = sizeof(raw_size);
+        out.clear();
+    }
+    if (raw_size > max_size) return false;
+    size_t kept = out.size();
+    out.resize(kept + raw_size);
+    return lz4_decompress(body + prefix, len - prefix, out.data() + kept, raw_size);
+}
+
+CompressionStats compression_stats() {
+    CompressionStats s;
+    s.blocks = stat_blocks.load(std::memory_order_relaxed);
+    s.raw_bytes = stat_raw.load(std::memory_order_relaxed);
+    s.compressed_bytes = stat_compressed.load(std::memory_order_relaxed);
+    s.stored_bytes = stat_stored.load(std::memory_order_relaxed);
+    s.nanos = stat_nanos.load(std::memory_order_relaxed);
+    return s;
+}
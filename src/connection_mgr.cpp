@@ -0,0 +1,128 @@
+#include "../include/connection_mgr.h"
+
+ConnectionMgr::ConnectionMgr()
+    : duplicate_policy(DuplicateLoginPolicy::KickOld), membership_version(0),
+      snapshot(std::make_shared<const Snapshot>(Snapshot{0, UserList()})) {}
+
+void ConnectionMgr::set_duplicate_login_policy(DuplicateLoginPolicy policy) {
+    std::unique_lock<std::shared_mutex> lock(name_mutex);
+    duplicate_policy = policy;
+}
+
+std::shared_ptr<UserContext> ConnectionMgr::add_connection(int fd, EventLoop* loop) {
+    auto user = std::make_shared<UserContext>(fd, loop);
+    Shard& shard = shard_for(fd);
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.connections[fd] = user;
+    }
+    membership_version.fetch_add(1, std::memory_order_release);
+    return user;
+}
+
+void ConnectionMgr::remove_connection(int fd) {
+    std::shared_ptr<UserContext> user;
+    Shard& shard = shard_for(fd);
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.connections.find(fd);
+        if (it == shard.connections.end()) return;
+        user = std::move(it->second);
+        shard.connections.erase(it);
+    }
+    membership_version.fetch_add(1, std::memory_order_release);
+
+    std::unique_lock<std::shared_mutex> lock(name_mutex);
+    // A login racing with this disconnect must not re-index a dead session
+    user->unregistered = true;
+    unindex_username(user);
+}
+
+bool ConnectionMgr::bind_username(const std::shared_ptr<UserContext>& user, const std::string& username,
+                                  std::shared_ptr<UserContext>& displaced) {
+    std::unique_lock<std::shared_mutex> lock(name_mutex);
+    if (user->unregistered) return false;
+
+    auto it = by_username.find(username);
+    if (it != by_username.end() && it->second != user) {
+        if (duplicate_policy == DuplicateLoginPolicy::RejectNew) {
+            return false;
+        }
+        // displaced->username is left alone (its own handlers may be reading
+        // it); unindex_username() compares owners, so its removal is a no-op
+        displaced = it->second;
+        by_username.erase(it);
+    }
+    unindex_username(user);
+    user->username = username;
+    by_username[username] = user;
+    return true;
+}
+
+std::shared_ptr<UserContext> ConnectionMgr::get_user_by_fd(int fd) {
+    Shard& shard = shard_for(fd);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.connections.find(fd);
+    if (it != shard.connections.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
+int ConnectionMgr::get_fd_by_username(const std::string& username) {
+    auto user = get_user_by_username(username);
+    return user ? user->fd : -1;
+}
+
+std::shared_ptr<UserContext> ConnectionMgr::get_user_by_username(const std::string& username) {
+    std::shared_lock<std::shared_mutex> lock(name_mutex);
+    auto it = by_username.find(username);
+    if (it != by_username.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
+UserListPtr ConnectionMgr::get_all_users() {
+    uint64_t version = membership_version.load(std::memory_order_acquire);
+    std::shared_ptr<const Snapshot> current = std::atomic_load(&snapshot);
+    if (current->version != version) {
+        std::lock_guard<std::mutex> rebuild_lock(rebuild_mutex);
+        // Another scan may have rebuilt while we waited for rebuild_mutex
+        current = std::atomic_load(&snapshot);
+        version = membership_version.load(std::memory_order_acquire);
+        if (current->version != version) {
+            auto fresh = std::make_shared<Snapshot>();
+            fresh->version = version;
+            fresh->users.reserve(current->users.size() + 16);
+            for (Shard& shard : shards) {
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                for (const auto& kv : shard.connections) {
+                    fresh->users.push_back(kv.second);
+                }
+            }
+            current = fresh;
+            std::atomic_store(&snapshot, current);
+        }
+    }
+    // Aliasing constructor: shares ownership of the snapshot, no allocation
+    return UserListPtr(current, &current->users);
+}
+
+std::vector<int> ConnectionMgr::get_all_fds() {
+    UserListPtr users = get_all_users();
+    std::vector<int> fds;
+    fds.reserve(users->size());
+    for (const auto& user : *users) {
+        fds.push_back(user->fd);
+    }
+    return fds;
+}
+
+void ConnectionMgr::unindex_username(const std::shared_ptr<UserContext>& user) {
+    if (user->username.empty()) return;
+    auto it = by_username.find(user->username);
+    if (it != by_username.end() && it->second == user) {
+        by_username.erase(it);
+    }
+}
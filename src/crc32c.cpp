@@ -0,0 +1,177 @@
+#include "../include/crc32c.h"
+#include <cstring>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+static const uint32_t kPoly = 0x82F63B78;  // Castagnoli polynomial, bit-reflected
+
+// --- Slicing-by-8 ---
+
+namespace {
+
+struct Tables {
+    uint32_t slice[8][256];
+    uint32_t x2n[32];  // x^(2^n) mod P, for shifting a CRC past n zero bits
+    Tables();
+};
+
+// a * b mod P, both reflected polynomials
+uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ kPoly : b >> 1;
+    }
+    return p;
+}
+
+Tables::Tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc & 1) ? (crc >> 1) ^ kPoly : crc >> 1;
+        slice[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int t = 1; t < 8; ++t) slice[t][i] = (slice[t - 1][i] >> 8) ^ slice[0][slice[t - 1][i] & 0xFF];
+    }
+    uint32_t p = 1u << 30;  // x^1
+    x2n[0] = p;
+    for (int n = 1; n < 32; ++n) x2n[n] = p = multmodp(p, p);
+}
+
+const Tables& tables() {
+    static const Tables instance;
+    return instance;
+}
+
+// x^(8 * bytes) mod P: multiplying a CRC register by it appends that many zero bytes
+uint32_t shift_bytes(size_t bytes) {
+    const Tables& t = tables();
+    uint32_t p = 1u << 31;  // x^0
+    unsigned k = 3;         // 2^3 bits per byte
+    while (bytes) {
+        if (bytes & 1) p = multmodp(t.x2n[k & 31], p);
+        bytes >>= 1;
+        k++;
+    }
+    return p;
+}
+
+}  // namespace
+
+uint32_t crc32c_sw(const void* data, size_t len, uint32_t crc) {
+    const Tables& t = tables();
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    while (len && (reinterpret_cast<uintptr_t>(p) & 7)) {
+        crc = (crc >> 8) ^ t.slice[0][(crc ^ *p++) & 0xFF];
+        len--;
+    }
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t.slice[7][lo & 0xFF] ^ t.slice[6][(lo >> 8) & 0xFF] ^ t.slice[5][(lo >> 16) & 0xFF] ^
+              t.slice[4][lo >> 24] ^ t.slice[3][hi & 0xFF] ^ t.slice[2][(hi >> 8) & 0xFF] ^
+              t.slice[1][(hi >> 16) & 0xFF] ^ t.slice[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = (crc >> 8) ^ t.slice[0][(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+// --- SSE4.2 ---
+
+#if defined(__x86_64__)
+
+// The crc32 instruction has a latency of 3 cycles but issues every cycle:
+// three independent streams over adjacent stripes keep it busy, and are
+// merged by shifting the earlier ones past the later stripes.
+static const size_t kStripe = 4096;
+
+__attribute__((target("sse4.2")))
+static uint64_t crc_words(uint64_t crc, const uint8_t* p, size_t words) {
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t v;
+        memcpy(&v, p + i * 8, 8);
+        crc = _mm_crc32_u64(crc, v);
+    }
+    return crc;
+}
+
+__attribute__((target("sse4.2")))
+uint32_t crc32c_hw(const void* data, size_t len, uint32_t crc) {
+    static const uint32_t shift1 = shift_bytes(kStripe);
+    static const uint32_t shift2 = shift_bytes(2 * kStripe);
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t c = ~crc;
+    while (len && (reinterpret_cast<uintptr_t>(p) & 7)) {
+        c = _mm_crc32_u8(c, *p++);
+        len--;
+    }
+    uint64_t c0 = c;
+    while (len >= 3 * kStripe) {
+        uint64_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < kStripe; i += 8) {
+            uint64_t v0, v1, v2;
+            memcpy(&v0, p + i, 8);
+            memcpy(&v1, p + kStripe + i, 8);
+            memcpy(&v2, p + 2 * kStripe + i, 8);
+            c0 = _mm_crc32_u64(c0, v0);
+            c1 = _mm_crc32_u64(c1, v1);
+            c2 = _mm_crc32_u64(c2, v2);
+        }
+        // The register update is linear: state(s, B) = shift(s) ^ state(0, B)
+        c0 = multmodp(shift2, (uint32_t)c0) ^ multmodp(shift1, (uint32_t)c1) ^ (uint32_t)c2;
+        p += 3 * kStripe;
+        len -= 3 * kStripe;
+    }
+    c0 = crc_words(c0, p, len / 8);
+    p += len & ~(size_t)7;
+    len &= 7;
+    c = (uint32_t)c0;
+    while (len--) c = _mm_crc32_u8(c, *p++);
+    return ~c;
+}
+
+bool crc32c_hw_available() {
+    static const bool available = __builtin_cpu_supports("sse4.2");
+    return available;
+}
+
+#else
+
+uint32_t crc32c_hw(const void* data, size_t len, uint32_t crc) {
+    return crc32c_sw(data, len, crc);
+}
+
+bool crc32c_hw_available() {
+    return false;
+}
+
+#endif
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc) {
+    static const bool hw = crc32c_hw_available();
+    return hw ? crc32c_hw(data, len, crc) : crc32c_sw(data, len, crc);
+}
+
+uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b) {
+    return multmodp(shift_bytes(len_b), crc_a) ^ crc_b;
+}
+
+bool crc_verify_from_name(const std::string& name, CrcVerify& mode) {
+    if (name == "off") mode = CrcVerify::Off;
+    else if (name == "sample") mode = CrcVerify::Sample;
+    else if (name == "all") mode = CrcVerify::All;
+    else return false;
+    return true;
+}
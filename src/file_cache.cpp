@@ -0,0 +1,328 @@
+#include "../include/file_cache.h"
+#include "../include/logger.h"
+#include "../include/crc32c.h"
+#include "../include/compression.h"
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+
+// A stats line is logged every this many lookups
+static const uint64_t kStatsLogInterval = 1000;
+// Bookkeeping charged per compressed range on top of its data, so the
+// "does not shrink" entries count against the limit too
+static const size_t kRangeOverhead = 128;
+
+CachedFile::~CachedFile() {
+    close(fd);
+}
+
+// CRC of len bytes at offset read with pread into a per-thread buffer.
+// nowait: only from the page cache, false (EAGAIN) if it would go to disk.
+static bool read_crc(int fd, off_t offset, size_t len, uint32_t& crc, bool nowait = false) {
+    thread_local std::unique_ptr<char[]> buffer(new char[CachedFile::kCrcBlock]);
+    size_t done = 0;
+    while (done < len) {
+        struct iovec iov = {buffer.get() + done, len - done};
+        ssize_t n = preadv2(fd, &iov, 1, offset + done, nowait ? RWF_NOWAIT : 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    crc = crc32c(buffer.get(), len, crc);
+    return true;
+}
+
+static const uint64_t kCrcKnown = 1ULL << 32;
+
+std::atomic<uint64_t>* CachedFile::crc_table() const {
+    std::call_once(crc_once, [this] {
+        block_crcs.reset(new std::atomic<uint64_t>[size / kCrcBlock + 1]());
+    });
+    return block_crcs.get();
+}
+
+bool CachedFile::range_crc(off_t offset, size_t len, uint32_t& crc) const {
+    return combine_crc(offset, len, crc, false);
+}
+
+bool CachedFile::cached_range_crc(off_t offset, size_t len, uint32_t& crc) const {
+    return combine_crc(offset, len, crc, true);
+}
+
+bool CachedFile::combine_crc(off_t offset, size_t len, uint32_t& crc, bool nowait) const {
+    if (offset < 0 || len > (uint64_t)(size - offset)) return false;
+    std::atomic<uint64_t>* blocks = crc_table();
+
+    crc = 0;
+    off_t pos = offset;
+    off_t end = offset + len;
+    while (pos < end) {
+        size_t block = pos / kCrcBlock;
+        off_t block_start = (off_t)block * kCrcBlock;
+        off_t block_end = std::min<off_t>(block_start + kCrcBlock, size);
+        if (pos == block_start && block_end <= end) {
+            uint64_t slot = blocks[block].load(std::memory_order_relaxed);
+            uint32_t block_crc = 0;
+            if (slot & kCrcKnown) {
+                block_crc = (uint32_t)slot;
+            } else {
+                if (nowait) return false;
+                if (!read_crc(fd, block_start, block_end - block_start, block_crc)) return false;
+                blocks[block].store(kCrcKnown | block_crc, std::memory_order_relaxed);
+            }
+            crc = crc32c_combine(crc, block_crc, block_end - block_start);
+            pos = block_end;
+        } else {
+            // Partial block at either end of the range
+            off_t piece_end = std::min(block_end, end);
+            if (!read_crc(fd, pos, piece_end - pos, crc, nowait)) return false;
+            pos = piece_end;
+        }
+    }
+    return true;
+}
+
+void CachedFile::warm_crcs(off_t offset, size_t len) const {
+    if (offset < 0 || offset >= size || len == 0) return;
+    std::atomic<uint64_t>* blocks = crc_table();
+    off_t end = std::min<off_t>(size, offset + len);
+    for (size_t block = offset / kCrcBlock; (off_t)(block * kCrcBlock) < end; ++block) {
+        if (blocks[block].load(std::memory_order_relaxed) & kCrcKnown) continue;
+        off_t block_start = (off_t)block * kCrcBlock;
+        off_t block_end = std::min<off_t>(block_start + kCrcBlock, size);
+        uint32_t block_crc = 0;
+        if (!read_crc(fd, block_start, block_end - block_start, block_crc)) return;
+        blocks[block].store(kCrcKnown | block_crc, std::memory_order_relaxed);
+    }
+}
+
+FileCache::FileCache(const std::string& directory, size_t entry_limit, size_t memory_limit, size_t small_limit,
+                     size_t compressed_limit)
+    : dir(directory), max_entries(entry_limit), max_memory(memory_limit),
+      small_file_limit(small_limit), max_compressed(compressed_limit), inotify_fd(-1), watching(false), generation(0), counters() {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        LOG_ERROR("inotify unavailable, file cache will stat() on every hit");
+        return;
+    }
+    uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM |
+                    IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(inotify_fd, dir.c_str(), mask) < 0) {
+        LOG_ERROR("Cannot watch " + dir + ", file cache will stat() on every hit");
+        close(inotify_fd);
+        inotify_fd = -1;
+        return;
+    }
+    watching = true;
+}
+
+FileCache::~FileCache() {
+    if (inotify_fd >= 0) close(inotify_fd);
+}
+
+bool FileCache::still_valid(const std::string& path, const Entry& entry) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) return false;
+    return st.st_dev == entry.dev && st.st_ino == entry.ino && st.st_size == entry.file->size &&
+           st.st_mtim.tv_sec == entry.mtime.tv_sec && st.st_mtim.tv_nsec == entry.mtime.tv_nsec;
+}
+
+void FileCache::erase(std::unordered_map<std::string, Entry>::iterator it) {
+    if (it->second.file->content) counters.memory_bytes -= it->second.file->content->size();
+    lru.erase(it->second.lru_pos);
+    entries.erase(it);
+}
+
+void FileCache::enforce_limits() {
+    while (!lru.empty() && (entries.size() > max_entries || counters.memory_bytes > max_memory)) {
+        erase(entries.find(lru.back()));
+        counters.evictions++;
+    }
+}
+
+CachedFilePtr FileCache::acquire(const std::string& name, std::string& error) {
+    std::string path = dir + "/" + name;
+    uint64_t lookups;
+    uint64_t seen_generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        if (it != entries.end()) {
+            if (watching || still_valid(path, it->second)) {
+                counters.hits++;
+                lru.splice(lru.begin(), lru, it->second.lru_pos);
+                return it->second.file;
+            }
+            counters.invalidations++;
+            erase(it);
+        }
+        counters.misses++;
+        lookups = counters.hits + counters.misses;
+        seen_generation = generation;
+    }
+    if (lookups % kStatsLogInterval == 0) {
+        Stats s = stats();
+        LOG_INFO("File cache: " + std::to_string(s.hits) + " hits, " + std::to_string(s.misses) +
+                 " misses, " + std::to_string(s.entries) + " entries, " +
+                 std::to_string(s.memory_bytes) + " bytes in memory, compressed ranges " +
+                 std::to_string(s.compressed_hits) + " hits / " + std::to_string(s.compressed_misses) +
+                 " misses, " + std::to_string(s.compressed_bytes) + " bytes");
+    }
+
+    // Miss: open and read outside the lock
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open file: " + path);
+        error = "File not found: " + name;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        error = "Not a regular file: " + name;
+        return nullptr;
+    }
+
+    auto file = std::make_shared<CachedFile>(fd, name, st.st_size);
+    if ((size_t)st.st_size <= small_file_limit && (size_t)st.st_size <= max_memory) {
+        std::string data(st.st_size, '\0');
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = pread(fd, &data[done], data.size() - done, done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += n;
+        }
+        // A short read means the file changed meanwhile: serve it from the fd
+        if (done == data.size()) {
+            file->content = std::make_shared<const std::string>(std::move(data));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(name);
+    if (it != entries.end()) {
+        // Another worker loaded it first; share that one
+        return it->second.file;
+    }
+    if (generation != seen_generation) {
+        // The directory changed while we were opening: serve, don't cache
+        return file;
+    }
+    lru.push_front(name);
+    entries.emplace(name, Entry{file, st.st_dev, st.st_ino, st.st_mtim, lru.begin()});
+    if (file->content) counters.memory_bytes += file->content->size();
+    enforce_limits();
+    return file;
+}
+
+void FileCache::erase_range(std::unordered_map<RangeKey, Range, RangeKeyHash>::iterator it) {
+    counters.compressed_bytes -= it->second.data->size() + kRangeOverhead;
+    range_lru.erase(it->second.lru_pos);
+    ranges.erase(it);
+}
+
+bool FileCache::cached_compressed_range(const CachedFilePtr& file, off_t offset, size_t len,
+                                        std::shared_ptr<const std::string>& packed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ranges.find(RangeKey{file.get(), offset, len});
+    if (it == ranges.end() || it->second.file.lock() != file) return false;
+    counters.compressed_hits++;
+    range_lru.splice(range_lru.begin(), range_lru, it->second.lru_pos);
+    packed = it->second.data->empty() ? nullptr : it->second.data;
+    return true;
+}
+
+std::shared_ptr<const std::string> FileCache::compressed_range(const CachedFilePtr& file, off_t offset, size_t len) {
+    if (offset < 0 || len == 0 || len > (uint64_t)(file->size - offset)) return nullptr;
+    RangeKey key{file.get(), offset, len};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ranges.find(key);
+        if (it != ranges.end()) {
+            if (it->second.file.lock() == file) {
+                counters.compressed_hits++;
+                range_lru.splice(range_lru.begin(), range_lru, it->second.lru_pos);
+                return it->second.data->empty() ? nullptr : it->second.data;
+            }
+            erase_range(it);
+        }
+        counters.compressed_misses++;
+    }
+
+    // Miss: read and compress outside the lock
+    const char* data;
+    thread_local std::string buffer;
+    if (file->content) {
+        data = file->content->data() + offset;
+    } else {
+        buffer.resize(len);
+        size_t done = 0;
+        while (done < len) {
+            ssize_t n = pread(file->fd, &buffer[done], len - done, offset + done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return nullptr;
+            done += n;
+        }
+        data = buffer.data();
+    }
+    auto packed = std::make_shared<std::string>();
+    compress_block(data, len, *packed);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ranges.find(key) == ranges.end() && packed->size() + kRangeOverhead <= max_compressed) {
+        range_lru.push_front(key);
+        ranges.emplace(key, Range{file, packed, range_lru.begin()});
+        counters.compressed_bytes += packed->size() + kRangeOverhead;
+        while (counters.compressed_bytes > max_compressed) {
+            erase_range(ranges.find(range_lru.back()));
+        }
+    }
+    return packed->empty() ? nullptr : packed;
+}
+
+void FileCache::process_events() {
+    alignas(struct inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = read(inotify_fd, buf, sizeof(buf));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return;  // EAGAIN: drained
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        for (char* p = buf; p < buf + n;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                // Lost events or lost the directory: trust nothing cached
+                counters.invalidations += entries.size();
+                while (!entries.empty()) erase(entries.begin());
+                if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    LOG_ERROR("Lost inotify watch on " + dir + ", file cache will stat() on every hit");
+                    watching = false;
+                }
+                continue;
+            }
+            if (event->len == 0) continue;
+            auto it = entries.find(event->name);
+            if (it != entries.end()) {
+                counters.invalidations++;
+                erase(it);
+            }
+        }
+    }
+}
+
+FileCache::Stats FileCache::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s = counters;
+    s.entries = entries.size();
+    return s;
+}
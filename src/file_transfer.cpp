@@ -1,54 +1,70 @@
 #include "../include/file_transfer.h"
-#include "../include/protocol.h"
-#include "../include/logger.h"
-#include <sys/sendfile.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
+#include "../include/crc32c.h"
+#include <algorithm>
 #include <cstring>
-#include <vector>
-
-void FileTransfer::handle_file_request(int client_fd, const std::string& filename) {
-    std::string full_path = "./file_storage/" + filename;
-    
-    int file_fd = open(full_path.c_str(), O_RDONLY);
-    if (file_fd < 0) {
-        LOG_ERROR("Failed to open file: " + full_path);
-        // Optional: Send error message to client
-        return;
-    }
+#include <unistd.h>
 
-    struct stat stat_buf;
-    fstat(file_fd, &stat_buf);
-    
-    // 1. Send Header indicating File Data is coming
+const char* const FileTransfer::kStorageDir = "./file_storage";
+
+FileJob::FileJob(const CachedFilePtr& cached, off_t range_start, off_t range_end)
+    : file(cached), name(cached->name), size(cached->size), start(range_start), end(range_end),
+      offset(range_start), transfer_id(0),
+      prefix_sent(0), chunk_left(0), compress(false), crc_warm_end(0), compress_warm_end(0), active(nullptr) {
+    memset(chunk_prefix, 0, sizeof(chunk_prefix));
+    pipe_fds[0] = pipe_fds[1] = -1;
+}
+
+FileJob::~FileJob() {
+    if (pipe_fds[0] != -1) close(pipe_fds[0]);
+    if (pipe_fds[1] != -1) close(pipe_fds[1]);
+    if (active) active->fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t FileJob::next_chunk_len(size_t max_len) const {
+    size_t len = compress ? max_len - (size_t)(offset % max_len) : max_len;
+    return (size_t)std::min<off_t>(len, end - offset);
+}
+
+bool FileJob::begin_chunk(off_t chunk_offset, size_t len) {
+    FileChunkHeader chunk;
+    chunk.offset = chunk_offset;
+    chunk.transfer_id = transfer_id;
+    chunk.length = len;
+    // Body checksum from the chunk header's CRC and the file range's (cached
+    // per block by the CachedFile): the data itself stays zero-copy
+    uint32_t data_crc;
     PacketHeader header;
+    header.total_len = kPrefixSize + len;
     header.msg_type = MSG_FILE_DATA;
     header.crc32 = 0;
-    // Total len = Header + File Content
-    // Note: If file is huge (>2GB), int32_t length might overflow. 
-    // For this project, assuming files < 2GB.
-    header.total_len = sizeof(PacketHeader) + stat_buf.st_size;
-
-    // Send Header first (Standard write)
-    write(client_fd, &header, sizeof(PacketHeader));
-
-    // 2. Zero-Copy Send
-    off_t offset = 0;
-    size_t remaining = stat_buf.st_size;
-    
-    LOG_INFO("Starting zero-copy transfer for " + filename + " (" + std::to_string(remaining) + " bytes)");
-    
-    while (remaining > 0) {
-        ssize_t sent = sendfile(client_fd, file_fd, &offset, remaining);
-        if (sent <= 0) {
-            if (errno == EAGAIN) continue;
-            LOG_ERROR("sendfile failed");
-            break;
-        }
-        remaining -= sent;
+    bool verified = file->cached_range_crc(chunk_offset, len, data_crc);
+    if (verified) {
+        header.crc32 = static_cast<int32_t>(crc32c_combine(crc32c(&chunk, sizeof(chunk)), data_crc, len));
+    }
+    memcpy(chunk_prefix, &header, sizeof(header));
+    memcpy(chunk_prefix + sizeof(header), &chunk, sizeof(chunk));
+    chunk_left = len;
+    return verified;
+}
+
+FileJobPtr FileTransfer::open_job(FileCache& cache, const std::string& filename, uint64_t offset, uint64_t length,
+                                  std::string& error) {
+    // No paths: the name must stay inside the storage directory
+    if (filename.empty() || filename == "." || filename == ".." || filename.find('/') != std::string::npos) {
+        error = "Invalid file name: " + filename;
+        return nullptr;
     }
-    
-    LOG_INFO("File transfer complete.");
-    close(file_fd);
+
+    CachedFilePtr file = cache.acquire(filename, error);
+    if (!file) return nullptr;
+
+    uint64_t size = file->size;
+    if (offset > size) {
+        error = "Range beyond end of file: " + filename;
+        return nullptr;
+    }
+    uint64_t available = size - offset;
+    if (length == 0 || length > available) length = available;
+
+    return std::make_shared<FileJob>(file, offset, offset + length);
 }
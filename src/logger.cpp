@@ -0,0 +1,137 @@
+#include "../include/logger.h"
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const size_t kBatchBytes = 64 * 1024;  // Flush the batch once it grows past this
+static const int kIdleSleepMs = 5;            // Writer nap when the ring is empty
+
+std::atomic<int> Logger::min_level(INFO);
+
+Logger& Logger::instance() {
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger()
+    : ring(kRingCapacity), dropped_count(0), output_fd(STDOUT_FILENO),
+      reported_drops(0), cached_second(-1) {
+    cached_stamp[0] = '\0';
+    batch.reserve(kBatchBytes + sizeof(Record) + 64);
+    writer = std::thread(&Logger::writer_loop, this);
+    writer.detach();
+    std::atexit([] { Logger::instance().flush(); });
+}
+
+bool Logger::parse_level(const std::string& name, LogLevel& level) {
+    if (name == "debug") level = DEBUG;
+    else if (name == "info") level = INFO;
+    else if (name == "warning") level = WARNING;
+    else if (name == "error") level = ERROR;
+    else return false;
+    return true;
+}
+
+bool Logger::set_output(const std::string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    drain();  // What was logged so far still goes to the old output
+    int old = output_fd.exchange(fd);
+    if (old > STDERR_FILENO) close(old);
+    return true;
+}
+
+void Logger::log(LogLevel level, const std::string& message) {
+    Record record;
+    record.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.level = level;
+    record.len = message.size() < kMaxMessage ? message.size() : kMaxMessage;
+    memcpy(record.text, message.data(), record.len);
+
+    if (!ring.try_push(record)) {
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::flush() {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    drain();
+}
+
+void Logger::writer_loop() {
+    for (;;) {
+        bool wrote;
+        {
+            std::lock_guard<std::mutex> lock(drain_mutex);
+            wrote = drain();
+        }
+        if (!wrote) std::this_thread::sleep_for(std::chrono::milliseconds(kIdleSleepMs));
+    }
+}
+
+static void write_all(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;  // Nowhere to report it: give the batch up
+        done += n;
+    }
+}
+
+void Logger::append_line(int64_t time_ms, LogLevel level, const char* text, size_t len) {
+    // Formatting the date is the expensive part: redo it once per second
+    int64_t second = time_ms / 1000;
+    if (second != cached_second) {
+        time_t t = (time_t)second;
+        struct tm local;
+        localtime_r(&t, &local);
+        strftime(cached_stamp, sizeof(cached_stamp), "%Y-%m-%d %H:%M:%S", &local);
+        cached_second = second;
+    }
+
+    static const char* const kNames[] = {"[DEBUG] ", "[INFO] ", "[WARNING] ", "[ERROR] "};
+    batch += '[';
+    batch += cached_stamp;
+    batch += "] ";
+    batch += kNames[level];
+    batch.append(text, len);
+    batch += '\n';
+}
+
+bool Logger::drain() {
+    int fd = output_fd.load();
+    bool wrote = false;
+
+    uint64_t drops = dropped_count.load(std::memory_order_relaxed);
+    if (drops != reported_drops) {
+        std::string note = "Logger dropped " + std::to_string(drops - reported_drops) + " message(s): ring full";
+        int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        append_line(now, WARNING, note.data(), note.size());
+        reported_drops = drops;
+    }
+
+    Record record;
+    while (ring.try_pop(record)) {
+        append_line(record.time_ms, record.level, record.text, record.len);
+        if (batch.size() >= kBatchBytes) {
+            write_all(fd, batch);
+            batch.clear();
+            wrote = true;
+        }
+    }
+    if (!batch.empty()) {
+        write_all(fd, batch);
+        batch.clear();
+        wrote = true;
+    }
+    return wrote;
+}
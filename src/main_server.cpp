@@ -1,24 +1,135 @@
 #include <iostream>
+#include <string>
 #include <unistd.h>
+#include <csignal>
 #include "../include/reactor.h"
 #include "../include/threadpool.h"
 #include "../include/logger.h"
+#include "../include/server_config.h"
+
+// Parses --key=value flags into config. Unknown flags are rejected.
+static bool parse_args(int argc, char* argv[], ServerConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            return false;
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+
+        try {
+            if (key == "port") config.port = std::stoi(value);
+            else if (key == "ip") config.ip = value;
+            else if (key == "workers") config.worker_threads = std::stoi(value);
+            else if (key == "reactors") config.reactor_threads = std::stoi(value);
+            else if (key == "event-backend") {
+                if (value == "epoll") config.event_backend = EventBackend::Epoll;
+                else if (value == "io_uring") config.event_backend = EventBackend::IoUring;
+                else return false;
+            }
+            else if (key == "edge-triggered") {
+                if (value == "on") config.edge_triggered = true;
+                else if (value == "off") config.edge_triggered = false;
+                else return false;
+            }
+            else if (key == "listen-backlog") config.listen_backlog = std::stoi(value);
+            else if (key == "send-high-water") config.send_high_water = std::stoul(value);
+            else if (key == "slow-consumer") {
+                if (value == "drop") config.slow_consumer_policy = SlowConsumerPolicy::Drop;
+                else if (value == "disconnect") config.slow_consumer_policy = SlowConsumerPolicy::Disconnect;
+                else return false;
+            }
+            else if (key == "duplicate-login") {
+                if (value == "kick") config.duplicate_login_policy = DuplicateLoginPolicy::KickOld;
+                else if (value == "reject") config.duplicate_login_policy = DuplicateLoginPolicy::RejectNew;
+                else return false;
+            }
+            else if (key == "heartbeat-timeout") config.heartbeat_timeout_sec = std::stoi(value);
+            else if (key == "timer-tick-ms") config.timer_tick_ms = std::stoi(value);
+            else if (key == "dispatch") {
+                if (value == "shared") config.dispatch_mode = DispatchMode::Shared;
+                else if (value == "serial") config.dispatch_mode = DispatchMode::Serial;
+                else return false;
+            }
+            else if (key == "write-coalescing") {
+                if (value == "on") config.write_coalescing = true;
+                else if (value == "off") config.write_coalescing = false;
+                else return false;
+            }
+            else if (key == "crc-verify") {
+                if (!crc_verify_from_name(value, config.crc_verify)) return false;
+            }
+            else if (key == "compression") {
+                if (value == "on") config.compression = true;
+                else if (value == "off") config.compression = false;
+                else return false;
+            }
+            else if (key == "compress-min") config.compress_min = std::stoul(value);
+            else if (key == "max-transfers") config.max_file_transfers = std::stoi(value);
+            else if (key == "file-cache-entries") config.file_cache_entries = std::stoul(value);
+            else if (key == "file-cache-memory") config.file_cache_memory = std::stoul(value);
+            else if (key == "file-cache-small") config.file_cache_small_file = std::stoul(value);
+            else if (key == "file-cache-compressed") config.file_cache_compressed = std::stoul(value);
+            else if (key == "log-level") {
+                if (!Logger::parse_level(value, config.log_level)) return false;
+            }
+            else if (key == "log-file") config.log_file = value;
+            else if (key == "stats") {
+                if (value == "on") config.stats = true;
+                else if (value == "off") config.stats = false;
+                else return false;
+            }
+            else if (key == "admin-socket") config.admin_socket = value;
+            else return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    if (!parse_args(argc, argv, config)) {
+        std::cout << "Usage: " << argv[0] << " [--port=8080] [--ip=0.0.0.0] [--workers=4] [--reactors=1]"
+                  << " [--event-backend=epoll|io_uring] [--edge-triggered=on|off] [--listen-backlog=128]"
+                  << " [--send-high-water=bytes] [--slow-consumer=drop|disconnect]"
+                  << " [--duplicate-login=kick|reject]"
+                  << " [--heartbeat-timeout=30] [--timer-tick-ms=1000]"
+                  << " [--dispatch=serial|shared] [--write-coalescing=on|off]"
+                  << " [--crc-verify=off|sample|all] [--compression=on|off] [--compress-min=512]"
+                  << " [--max-transfers=16]"
+                  << " [--file-cache-entries=256] [--file-cache-memory=bytes] [--file-cache-small=bytes]"
+                  << " [--file-cache-compressed=bytes]"
+                  << " [--log-level=debug|info|warning|error] [--log-file=path]"
+                  << " [--stats=on|off] [--admin-socket=path]" << std::endl;
+        return 1;
+    }
+
+    Logger::set_level(config.log_level);
+    if (!config.log_file.empty() && !Logger::instance().set_output(config.log_file)) {
+        std::cerr << "Cannot open log file " << config.log_file << std::endl;
+        return 1;
+    }
+
+    // A peer that disconnects mid-write must cost an EPIPE, not the process
+    signal(SIGPIPE, SIG_IGN);
 
-int main() {
     try {
         LOG_INFO("Starting ChatSystem Server...");
 
         // 1. Initialize ThreadPool
-        ThreadPool pool(4);
-        LOG_INFO("ThreadPool initialized with 4 workers.");
+        ThreadPool pool(config.worker_threads);
+        LOG_INFO("ThreadPool initialized with " + std::to_string(config.worker_threads) + " workers.");
 
         // 2. Initialize EpollServer
-        EpollServer server(&pool);
-        server.init(8080);
-        
+        EpollServer server(&pool, config);
+        server.init(config.port, config.ip.c_str());
+
         // 3. Start Event Loop
         server.run();
-        
+
     } catch (const std::exception& e) {
         LOG_ERROR("Server crashed: " + std::string(e.what()));
         return 1;
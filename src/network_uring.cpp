@@ -0,0 +1,354 @@
+#include "../include/reactor.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <fcntl.h>
+#include <algorithm>
+
+// io_uring backend of EventLoop (EventBackend::IoUring).
+// Same connection logic as the epoll path; only the I/O is issued
+// differently. Every operation is an SQE whose user_data points at a
+// UringOp; all SQEs queued during an iteration go to the kernel in the one
+// io_uring_enter() that also waits for the next completions.
+//   - listener: one multishot accept
+//   - clients: one multishot recv each, buffers picked by the kernel from
+//     the loop's provided-buffer ring and handed back right after copying
+//   - output: at most one send-side op in flight per connection
+//     (write_armed): a SENDMSG over the queued frames, or a step of the
+//     current download (splice file -> pipe, send prefix, splice pipe ->
+//     socket)
+//   - eventfd, timerfd, inotify: multishot poll, handled as with epoll
+// Client sockets stay blocking in this mode: ring operations never block the
+// loop, and a splice into a full socket then waits in the kernel instead of
+// failing with EAGAIN.
+
+static const unsigned kRingEntries = 1024;
+static const unsigned kRecvBuffers = 1024;     // Power of two
+static const unsigned kRecvBufferSize = 4096;
+static const size_t kSpliceChunk = 128 * 1024; // Same chunk size as the sendfile path
+
+struct EventLoop::UringOp {
+    enum Kind { Watch, Accept, Recv, Send, FileFill, FilePrefix, FileDrain };
+
+    Kind kind;
+    int fd;
+    std::shared_ptr<UserContext> user;
+    FileJobPtr job;
+    std::vector<struct iovec> iov;  // Send: the batch, over...
+    std::vector<FramePtr> frames;   // ...frames kept alive until completion
+    struct msghdr msg;
+
+    UringOp(Kind op_kind, int op_fd) : kind(op_kind), fd(op_fd) {}
+};
+
+bool EventLoop::init_uring() {
+    if (!Uring::supported()) {
+        LOG_WARNING("io_uring backend needs Linux 6.0 or later, loop " + std::to_string(loop_index) +
+                    " falls back to epoll");
+        return false;
+    }
+    std::unique_ptr<Uring> uring(new Uring());
+    if (!uring->init(kRingEntries, kRecvBuffers, kRecvBufferSize)) {
+        LOG_WARNING("io_uring unavailable (" + std::string(strerror(errno)) + "), loop " +
+                    std::to_string(loop_index) + " falls back to epoll");
+        return false;
+    }
+    ring = std::move(uring);
+    return true;
+}
+
+io_uring_sqe* EventLoop::uring_sqe(UringOp* op) {
+    io_uring_sqe* sqe = ring->get_sqe();
+    if (sqe) {
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+    } else {
+        LOG_ERROR("io_uring submission queue full on loop " + std::to_string(loop_index));
+    }
+    return sqe;
+}
+
+void EventLoop::free_uring_ops() {
+    for (UringOp* op : standing_ops) delete op;
+    standing_ops.clear();
+}
+
+bool EventLoop::uring_watch(int fd, UringOp* op) {
+    if (!op) {
+        op = new UringOp(UringOp::Watch, fd);
+        standing_ops.push_back(op);
+    }
+    io_uring_sqe* sqe = uring_sqe(op);
+    if (!sqe) return false;  // The op stays with standing_ops
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    return true;
+}
+
+bool EventLoop::uring_accept(UringOp* op) {
+    if (!op) {
+        op = new UringOp(UringOp::Accept, listen_fd);
+        standing_ops.push_back(op);
+    }
+    io_uring_sqe* sqe = uring_sqe(op);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    return true;
+}
+
+void EventLoop::uring_recv(const std::shared_ptr<UserContext>& user, UringOp* op) {
+    if (!op) {
+        op = new UringOp(UringOp::Recv, user->fd);
+        op->user = user;
+    }
+    io_uring_sqe* sqe = uring_sqe(op);
+    if (!sqe) {
+        delete op;
+        close_connection(user);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = user->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = Uring::kBufferGroup;
+}
+
+void EventLoop::uring_flush(const std::shared_ptr<UserContext>& user) {
+    // A completion brings us back for whatever was queued meanwhile
+    if (user->closed || user->write_armed) return;
+
+    OutputBatch batch;
+    std::vector<FramePtr> pinned;
+    if (!next_output(user, batch, &pinned)) return;
+    if (batch.job) {
+        uring_file_step(user, batch.job);
+        return;
+    }
+
+    UringOp* op = new UringOp(UringOp::Send, user->fd);
+    op->user = user;
+    op->iov.assign(batch.iov, batch.iov + batch.iovcnt);
+    op->frames.swap(pinned);
+    memset(&op->msg, 0, sizeof(op->msg));
+    op->msg.msg_iov = op->iov.data();
+    op->msg.msg_iovlen = op->iov.size();
+    io_uring_sqe* sqe = uring_sqe(op);
+    if (!sqe) {
+        delete op;
+        close_connection(user);
+        return;
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = user->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&op->msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL | (batch.more ? MSG_MORE : 0);
+    user->write_armed = true;
+    write_calls++;
+}
+
+void EventLoop::uring_file_step(const std::shared_ptr<UserContext>& user, const FileJobPtr& job) {
+    UringOp::Kind kind;
+    if (job->chunk_left == 0) {
+        if (job->offset == job->end) {
+            finish_file_job(user, job);
+            uring_flush(user);  // The MSG_FILE_END just queued
+            return;
+        }
+        if (queue_compressed_chunk(user, job, kSpliceChunk)) {
+            uring_flush(user);  // Goes out like any frame
+            return;
+        }
+        if (job->pipe_fds[0] == -1) {
+            if (pipe2(job->pipe_fds, O_CLOEXEC) < 0) {
+                LOG_ERROR("Failed to create splice pipe: " + std::string(strerror(errno)));
+                close_connection(user);
+                return;
+            }
+            // One whole chunk per fill where the pipe limit allows it
+            fcntl(job->pipe_fds[1], F_SETPIPE_SZ, (int)kSpliceChunk);
+        }
+        kind = UringOp::FileFill;
+    } else if (job->prefix_sent < FileJob::kPrefixSize) {
+        kind = UringOp::FilePrefix;
+    } else {
+        kind = UringOp::FileDrain;
+    }
+
+    UringOp* op = new UringOp(kind, user->fd);
+    op->user = user;
+    op->job = job;
+    io_uring_sqe* sqe = uring_sqe(op);
+    if (!sqe) {
+        delete op;
+        close_connection(user);
+        return;
+    }
+    if (kind == UringOp::FileFill) {
+        // File -> pipe; the chunk is sized by what actually arrives
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->fd = job->pipe_fds[1];
+        sqe->off = (uint64_t)-1;
+        sqe->splice_fd_in = job->file->fd;
+        sqe->splice_off_in = job->offset;
+        sqe->len = (unsigned)job->next_chunk_len(kSpliceChunk);
+    } else if (kind == UringOp::FilePrefix) {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = user->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(job->chunk_prefix + job->prefix_sent);
+        sqe->len = FileJob::kPrefixSize - job->prefix_sent;
+        sqe->msg_flags = MSG_MORE | MSG_NOSIGNAL;
+        write_calls++;
+    } else {
+        // Pipe -> socket
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->fd = user->fd;
+        sqe->off = (uint64_t)-1;
+        sqe->splice_fd_in = job->pipe_fds[0];
+        sqe->splice_off_in = (uint64_t)-1;
+        sqe->len = job->chunk_left;
+        sqe->splice_flags = job->offset < job->end ? SPLICE_F_MORE : 0;
+        write_calls++;
+    }
+    user->write_armed = true;
+}
+
+void EventLoop::handle_file_completion(UringOp* op, int res) {
+    const std::shared_ptr<UserContext>& user = op->user;
+    FileJob& job = *op->job;
+    if (res < 0 || (res == 0 && op->kind != UringOp::FilePrefix)) {
+        if (res == 0) {
+            // File shrank under us (fill), or the pipe came up empty
+            LOG_ERROR("File truncated during transfer: " + job.name);
+        } else {
+            LOG_ERROR("Write failed to fd " + std::to_string(user->fd) + ": " + strerror(-res));
+        }
+        close_connection(user);
+        return;
+    }
+
+    switch (op->kind) {
+        case UringOp::FileFill:
+            begin_file_chunk(op->job, job.offset, res);
+            job.offset += res;
+            break;
+        case UringOp::FilePrefix:
+            job.prefix_sent += res;
+            break;
+        default:
+            job.chunk_left -= res;
+            if (job.chunk_left == 0) {
+                job.prefix_sent = 0;
+                frames_written++;
+                count_file_chunk(job);
+            }
+            break;
+    }
+    uring_flush(user);
+}
+
+void EventLoop::handle_completion(const io_uring_cqe& cqe) {
+    UringOp* op = reinterpret_cast<UringOp*>(cqe.user_data);
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;  // Multishot still armed
+
+    switch (op->kind) {
+        case UringOp::Watch:
+            if (op->fd == wakeup_fd) {
+                handle_wakeup();
+            } else if (op->fd == timer_fd) {
+                handle_timer();
+            } else if (op->fd == notify_fd) {
+                server->file_cache().process_events();
+            }
+            if (!more) uring_watch(op->fd, op);
+            return;
+
+        case UringOp::Accept:
+            if (cqe.res >= 0) {
+                struct sockaddr_in client_addr;
+                socklen_t client_addr_len = sizeof(client_addr);
+                memset(&client_addr, 0, sizeof(client_addr));
+                getpeername(cqe.res, (struct sockaddr*)&client_addr, &client_addr_len);
+                accept_connection(cqe.res, client_addr);
+            } else if (cqe.res != -EAGAIN && cqe.res != -ECONNABORTED) {
+                LOG_ERROR("accept failed: " + std::string(strerror(-cqe.res)));
+            }
+            if (!more && running) uring_accept(op);
+            return;
+
+        case UringOp::Recv: {
+            const std::shared_ptr<UserContext>& user = op->user;
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                if (cqe.res > 0 && !user->closed) user->read_buffer.append(ring->buffer(bid), cqe.res);
+                ring->recycle_buffer(bid);
+            }
+            if (user->closed) {
+                if (!more) delete op;
+                return;
+            }
+            if (cqe.res > 0 || cqe.res == -ENOBUFS) {
+                // ENOBUFS: every buffer was taken; they are all back by now
+                if (cqe.res > 0 && !dispatch_packets(user, stats ? monotonic_ns() : 0)) {
+                    if (!more) delete op;
+                    return;
+                }
+                if (!more) uring_recv(user, op);
+                return;
+            }
+            if (cqe.res == 0) {
+                LOG_INFO("Client disconnected (fd: " + std::to_string(user->fd) + ")");
+            } else {
+                LOG_ERROR("read error on fd " + std::to_string(user->fd) + ": " + strerror(-cqe.res));
+            }
+            close_connection(user);
+            if (!more) delete op;
+            return;
+        }
+
+        case UringOp::Send: {
+            const std::shared_ptr<UserContext> user = op->user;
+            user->write_armed = false;
+            if (!user->closed) {
+                if (cqe.res >= 0) {
+                    consume_output(user, cqe.res);
+                } else if (cqe.res == -EAGAIN) {
+                    if (stats) ServerStats::bump(stats->local().write_eagain);
+                } else if (cqe.res != -EINTR) {
+                    LOG_ERROR("Write failed to fd " + std::to_string(user->fd) + ": " + strerror(-cqe.res));
+                    close_connection(user);
+                }
+            }
+            delete op;  // Releases the frames only now: the kernel is done with them
+            if (!user->closed) uring_flush(user);
+            return;
+        }
+
+        default:
+            op->user->write_armed = false;
+            if (!op->user->closed) handle_file_completion(op, cqe.res);
+            delete op;
+            return;
+    }
+}
+
+void EventLoop::run_uring() {
+    LOG_INFO("io_uring loop " + std::to_string(loop_index) + " starting...");
+
+    while (running) {
+        // One syscall submits everything queued since the last one and
+        // collects the completions
+        if (ring->submit_and_wait(1) < 0 && errno != EINTR && errno != EBUSY) {
+            LOG_ERROR("io_uring_enter failed: " + std::string(strerror(errno)));
+            break;
+        }
+        ring->for_each_cqe([this](const io_uring_cqe& cqe) { handle_completion(cqe); });
+
+        run_pending_functors();
+    }
+}
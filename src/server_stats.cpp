@@ -0,0 +1,72 @@
+#include "../include/server_stats.h"
+#include "../include/timing_wheel.h"
+
+namespace {
+std::atomic<int> next_shard(0);
+}
+
+ServerStats::ServerStats() : shards(new Shard[kShards]), start_ns(monotonic_ns()) {
+    reset();
+}
+
+ServerStats::Shard& ServerStats::local() {
+    // Per thread, not per instance: a thread keeps its slot in every ServerStats
+    thread_local int slot = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shards[slot];
+}
+
+void ServerStats::snapshot(Snapshot& out) const {
+    for (int s = 0; s < kStageCount; ++s) out.stages[s].reset();
+    for (int t = 0; t < kTypes; ++t) {
+        out.packets_in[t] = out.bytes_in[t] = out.packets_out[t] = out.bytes_out[t] = 0;
+    }
+    out.accepted = out.closed = out.read_eagain = out.write_eagain = 0;
+
+    for (int i = 0; i < kShards; ++i) {
+        const Shard& shard = shards[i];
+        for (int s = 0; s < kStageCount; ++s) out.stages[s].merge(shard.stages[s]);
+        for (int t = 0; t < kTypes; ++t) {
+            out.packets_in[t] += shard.packets_in[t].load(std::memory_order_relaxed);
+            out.bytes_in[t] += shard.bytes_in[t].load(std::memory_order_relaxed);
+            out.packets_out[t] += shard.packets_out[t].load(std::memory_order_relaxed);
+            out.bytes_out[t] += shard.bytes_out[t].load(std::memory_order_relaxed);
+        }
+        out.accepted += shard.accepted.load(std::memory_order_relaxed);
+        out.closed += shard.closed.load(std::memory_order_relaxed);
+        out.read_eagain += shard.read_eagain.load(std::memory_order_relaxed);
+        out.write_eagain += shard.write_eagain.load(std::memory_order_relaxed);
+    }
+}
+
+void ServerStats::reset() {
+    for (int i = 0; i < kShards; ++i) {
+        Shard& shard = shards[i];
+        for (int s = 0; s < kStageCount; ++s) shard.stages[s].reset();
+        for (int t = 0; t < kTypes; ++t) {
+            shard.packets_in[t].store(0, std::memory_order_relaxed);
+            shard.bytes_in[t].store(0, std::memory_order_relaxed);
+            shard.packets_out[t].store(0, std::memory_order_relaxed);
+            shard.bytes_out[t].store(0, std::memory_order_relaxed);
+        }
+        shard.accepted.store(0, std::memory_order_relaxed);
+        shard.closed.store(0, std::memory_order_relaxed);
+        shard.read_eagain.store(0, std::memory_order_relaxed);
+        shard.write_eagain.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string msg_type_name(int type) {
+    switch (type) {
+        case MSG_LOGIN: return "LOGIN";
+        case MSG_CHAT_PUBLIC: return "CHAT_PUBLIC";
+        case MSG_CHAT_PRIVATE: return "CHAT_PRIVATE";
+        case MSG_FILE_REQ: return "FILE_REQ";
+        case MSG_FILE_DATA: return "FILE_DATA";
+        case MSG_HEARTBEAT: return "HEARTBEAT";
+        case MSG_FILE_START: return "FILE_START";
+        case MSG_FILE_END: return "FILE_END";
+        case MSG_LOGIN_ACK: return "LOGIN_ACK";
+        case MSG_ERROR: return "ERROR";
+        default: return std::to_string(type);
+    }
+}
@@ -1,36 +1,147 @@
 #include "../include/threadpool.h"
+#include "../include/logger.h"
 
-ThreadPool::ThreadPool(size_t threads) : stop(false) {
+namespace {
+// Index of the calling worker in the pool it belongs to (-1 outside)
+thread_local const ThreadPool* tls_pool = nullptr;
+thread_local size_t tls_index = 0;
+
+// Cheap per-thread xorshift for picking steal victims
+size_t next_random() {
+    thread_local size_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+}
+
+ThreadPool::ThreadPool(size_t threads)
+    : next_queue(0), overflow_size(0), sleepers(0), wakeups(0), stop(false) {
+    if (threads == 0) threads = 1;
     for(size_t i = 0; i < threads; ++i)
-        workers.emplace_back(
-            [this] {
-                for(;;) {
-                    std::function<void()> task;
-
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        this->condition.wait(lock,
-                            [this]{ return this->stop || !this->tasks.empty(); });
-                        
-                        if(this->stop && this->tasks.empty())
-                            return;
-                        
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
-                    }
-
-                    task();
-                }
-            }
-        );
+        workers.emplace_back(new Worker());
+    for(size_t i = 0; i < threads; ++i)
+        workers[i]->thread = std::thread(&ThreadPool::worker_loop, this, i);
 }
 
 ThreadPool::~ThreadPool() {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        std::unique_lock<std::mutex> lock(park_mutex);
         stop = true;
     }
-    condition.notify_all();
-    for(std::thread &worker: workers)
-        worker.join();
+    park_cv.notify_all();
+    for(auto& worker : workers)
+        worker->thread.join();
+}
+
+void ThreadPool::submit(Task task) {
+    // Workers keep their own follow-up work local; reactors spread theirs
+    size_t n = workers.size();
+    size_t start = (tls_pool == this) ? tls_index : next_queue.fetch_add(1, std::memory_order_relaxed) % n;
+
+    // Once spilled, keep spilling until the overflow drains: everything in
+    // the rings is then older than the overflow, which keeps rough FIFO order
+    bool pushed = false;
+    if (overflow_size.load(std::memory_order_relaxed) == 0) {
+        for (size_t i = 0; i < n && !pushed; ++i) {
+            pushed = workers[(start + i) % n]->queue.try_push(std::move(task));
+        }
+    }
+    if (!pushed) {
+        std::lock_guard<std::mutex> lock(overflow_mutex);
+        overflow.push_back(std::move(task));
+        overflow_size.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake_one();
+}
+
+size_t ThreadPool::pending() const {
+    size_t n = overflow_size.load(std::memory_order_relaxed);
+    for (const auto& worker : workers) n += worker->queue.size_approx();
+    return n;
+}
+
+void ThreadPool::wake_one() {
+    // Pairs with the sleepers increment in worker_loop: either that worker's
+    // re-check sees our task, or we see it asleep and wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) == 0) return;
+
+    std::lock_guard<std::mutex> lock(park_mutex);
+    if (wakeups < sleepers.load(std::memory_order_relaxed)) {
+        wakeups++;
+        park_cv.notify_one();
+    }
+}
+
+bool ThreadPool::pop_overflow(Task& task) {
+    if (overflow_size.load(std::memory_order_relaxed) == 0) return false;
+    std::lock_guard<std::mutex> lock(overflow_mutex);
+    if (overflow.empty()) return false;
+    task = std::move(overflow.front());
+    overflow.pop_front();
+    overflow_size.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ThreadPool::find_task(size_t index, Task& task) {
+    if (workers[index]->queue.try_pop(task)) return true;
+
+    size_t n = workers.size();
+    size_t start = next_random();
+    for (size_t i = 0; i < n; ++i) {
+        size_t victim = (start + i) % n;
+        if (victim != index && workers[victim]->queue.try_pop(task)) return true;
+    }
+
+    return pop_overflow(task);
+}
+
+bool ThreadPool::has_work() const {
+    for (const auto& worker : workers) {
+        if (worker->queue.size_approx() > 0) return true;
+    }
+    return overflow_size.load(std::memory_order_seq_cst) > 0;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    tls_pool = this;
+    tls_index = index;
+
+    for(;;) {
+        Task task;
+        bool found = false;
+
+        // Spin: own queue, then steal
+        for (int spin = 0; spin < kSpinRounds && !found; ++spin) {
+            found = find_task(index, task);
+            if (!found && spin >= kSpinRounds / 2) std::this_thread::yield();
+        }
+
+        if (!found) {
+            std::unique_lock<std::mutex> lock(park_mutex);
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!has_work()) {
+                if (stop) {
+                    sleepers.fetch_sub(1, std::memory_order_relaxed);
+                    return;
+                }
+                park_cv.wait(lock, [this] { return wakeups > 0 || stop; });
+                if (wakeups > 0) wakeups--;
+            }
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // enqueue() tasks trap exceptions in their future; post() tasks have none
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR("ThreadPool: task threw: " + std::string(e.what()));
+        } catch (...) {
+            LOG_ERROR("ThreadPool: task threw an unknown exception");
+        }
+    }
 }
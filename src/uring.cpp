@@ -0,0 +1,159 @@
+#include "../include/uring.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+Uring::Uring()
+    : ring_fd(-1), ring_mem(MAP_FAILED), ring_len(0), sqes(nullptr), sqes_len(0),
+      sq_head(nullptr), sq_tail(nullptr), sq_mask(0), sq_entries(0), sqe_tail(0),
+      cq_head(nullptr), cq_tail(nullptr), cq_mask(0), cqes(nullptr),
+      buf_ring(nullptr), buf_ring_len(0), buffers(nullptr), buffers_len(0),
+      buffer_count(0), buffer_size(0), buf_tail(0), enters(0) {}
+
+Uring::~Uring() {
+    release();
+}
+
+void Uring::release() {
+    // Ring first: in-flight receives may still point into the buffers
+    if (ring_fd != -1) close(ring_fd);
+    if (sqes) munmap(sqes, sqes_len);
+    if (ring_mem != MAP_FAILED) munmap(ring_mem, ring_len);
+    if (buf_ring) munmap(buf_ring, buf_ring_len);
+    if (buffers) munmap(buffers, buffers_len);
+    buffers = nullptr;
+    buf_ring = nullptr;
+    sqes = nullptr;
+    ring_mem = MAP_FAILED;
+    ring_fd = -1;
+}
+
+bool Uring::supported() {
+    struct utsname name;
+    int major = 0;
+    if (uname(&name) != 0 || sscanf(name.release, "%d.", &major) != 1) return false;
+    return major >= 6;
+}
+
+bool Uring::init(unsigned entries, unsigned count, unsigned size) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    // Room for every multishot receive to post several completions per wait
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = entries * 4;
+
+    ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring_fd < 0) return false;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        release();
+        errno = ENOSYS;
+        return false;
+    }
+
+    size_t sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring_len = sq_len > cq_len ? sq_len : cq_len;
+    ring_mem = mmap(nullptr, ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                    IORING_OFF_SQ_RING);
+    if (ring_mem == MAP_FAILED) {
+        int saved = errno;
+        release();
+        errno = saved;
+        return false;
+    }
+    sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqe_mem = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                         IORING_OFF_SQES);
+    if (sqe_mem == MAP_FAILED) {
+        int saved = errno;
+        release();
+        errno = saved;
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqe_mem);
+
+    char* base = static_cast<char*>(ring_mem);
+    sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+    sqe_tail = *sq_tail;
+    // SQEs are used in ring order, so the indirection array is the identity
+    unsigned* sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries; ++i) sq_array[i] = i;
+
+    cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    // Provided-buffer ring: the kernel picks a buffer per received burst,
+    // so idle connections pin no receive memory
+    buffer_count = count;
+    buffer_size = size;
+    buf_ring_len = count * sizeof(io_uring_buf);
+    void* ring_area = mmap(nullptr, buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffers_len = (size_t)count * size;
+    void* buffer_area = mmap(nullptr, buffers_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring_area == MAP_FAILED || buffer_area == MAP_FAILED) {
+        int saved = errno;
+        if (ring_area != MAP_FAILED) munmap(ring_area, buf_ring_len);
+        if (buffer_area != MAP_FAILED) munmap(buffer_area, buffers_len);
+        release();
+        errno = saved;
+        return false;
+    }
+    buf_ring = static_cast<io_uring_buf_ring*>(ring_area);
+    buffers = static_cast<char*>(buffer_area);
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+    reg.ring_entries = count;
+    reg.bgid = kBufferGroup;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int saved = errno;
+        release();
+        errno = saved;
+        return false;
+    }
+    for (unsigned bid = 0; bid < count; ++bid) recycle_buffer((uint16_t)bid);
+    return true;
+}
+
+io_uring_sqe* Uring::get_sqe() {
+    if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+        if (submit_and_wait(0) < 0 ||
+            sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe_tail++;
+    return sqe;
+}
+
+int Uring::submit_and_wait(unsigned wait_nr) {
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    unsigned pending = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    enters++;
+    return (int)syscall(__NR_io_uring_enter, ring_fd, pending, wait_nr,
+                        wait_nr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+}
+
+void Uring::recycle_buffer(uint16_t bid) {
+    // Entries start at the ring's base (the tail overlays the first one's
+    // resv field); not via buf_ring->bufs, which C++ places 8 bytes further
+    // because of how the header declares the flexible array
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(buf_ring) + (buf_tail & (buffer_count - 1));
+    buf->addr = reinterpret_cast<uint64_t>(buffer(bid));
+    buf->len = buffer_size;
+    buf->bid = bid;
+    buf_tail++;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cassert>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include "../include/buffer.h"
+
+void test_cursors() {
+    std::cout << "[Test] Buffer Cursors: Starting..." << std::endl;
+
+    Buffer buf(16);
+    buf.append("hello", 5);
+    buf.append("world", 5);
+    assert(buf.readable() == 10);
+    assert(memcmp(buf.peek(), "helloworld", 10) == 0);
+
+    // Consuming only moves the read cursor
+    buf.retrieve(5);
+    assert(buf.readable() == 5);
+    assert(memcmp(buf.peek(), "world", 5) == 0);
+
+    // Needs compaction (6 free at tail + 5 consumed) rather than growth
+    buf.append("123456789", 9);
+    assert(buf.readable() == 14);
+    assert(memcmp(buf.peek(), "world123456789", 14) == 0);
+
+    // Needs growth
+    std::string big(100, 'x');
+    buf.append(big.data(), big.size());
+    assert(buf.readable() == 114);
+    assert(memcmp(buf.peek(), "world", 5) == 0);
+
+    buf.retrieve(114);
+    assert(buf.readable() == 0);
+
+    std::cout << "[Test] Buffer Cursors: Passed." << std::endl;
+}
+
+void test_read_fd() {
+    std::cout << "[Test] Buffer read_fd: Starting..." << std::endl;
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    // More than the initial tail: the excess lands in the readv stack area
+    std::vector<char> data(20000);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (char)(i * 7);
+    assert(write(fds[1], data.data(), data.size()) == (ssize_t)data.size());
+
+    Buffer buf;
+    size_t total = 0;
+    while (true) {
+        ssize_t n = buf.read_fd(fds[0]);
+        if (n <= 0) break;
+        total += n;
+    }
+    assert(total == data.size());
+    assert(buf.readable() == data.size());
+    assert(memcmp(buf.peek(), data.data(), data.size()) == 0);
+
+    close(fds[0]);
+    close(fds[1]);
+    std::cout << "[Test] Buffer read_fd: Passed." << std::endl;
+}
+
+void test_views() {
+    std::cout << "[Test] Buffer Views: Starting..." << std::endl;
+
+    size_t baseline = BlockPool::instance().outstanding();
+    {
+        Buffer buf;
+        buf.append("packet-1", 8);
+        PacketView first = buf.view(0, 8);
+        buf.retrieve(8);
+
+        // The consumed bytes are still referenced: filling the buffer past
+        // the block end must move on to a new block, not compact over them
+        std::string big(Buffer::kInitialSize, 'y');
+        buf.append("packet-2", 8);
+        buf.append(big.data(), big.size());
+        assert(first.size() == 8 && memcmp(first.data(), "packet-1", 8) == 0);
+        assert(buf.readable() == 8 + big.size());
+        assert(memcmp(buf.peek(), "packet-2yyyy", 12) == 0);
+        assert(BlockPool::instance().outstanding() == baseline + 2);
+
+        PacketView second = buf.view(0, 8);
+        buf.retrieve_all();
+        buf.append("packet-3", 8);
+        assert(memcmp(second.data(), "packet-2", 8) == 0);
+        assert(memcmp(buf.peek(), "packet-3", 8) == 0);
+    }
+    // Buffer and views gone: every block went back to the pool
+    assert(BlockPool::instance().outstanding() == baseline);
+
+    std::cout << "[Test] Buffer Views: Passed." << std::endl;
+}
+
+void test_lazy_block() {
+    std::cout << "[Test] Buffer Lazy Block: Starting..." << std::endl;
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    size_t baseline = BlockPool::instance().outstanding();
+    {
+        // Idle connections hold no receive memory, not even after a read
+        // that found nothing
+        Buffer buf;
+        assert(!buf.has_block() && buf.readable() == 0);
+        assert(buf.read_fd(fds[0]) < 0 && errno == EAGAIN);
+        assert(!buf.has_block());
+        assert(BlockPool::instance().outstanding() == baseline);
+
+        assert(write(fds[1], "partial", 7) == 7);
+        assert(buf.read_fd(fds[0]) == 7);
+        assert(buf.has_block() && memcmp(buf.peek(), "partial", 7) == 0);
+        buf.retrieve(3);
+        assert(buf.has_block());  // Bytes still pending
+
+        // Drained: the block goes back, or stays only with a view into it
+        PacketView view = buf.view(0, 4);
+        buf.retrieve(4);
+        assert(!buf.has_block());
+        assert(BlockPool::instance().outstanding() == baseline + 1);
+        assert(memcmp(view.data(), "tial", 4) == 0);
+        view = PacketView();
+        assert(BlockPool::instance().outstanding() == baseline);
+
+        buf.append("again", 5);
+        assert(buf.has_block() && memcmp(buf.peek(), "again", 5) == 0);
+        buf.retrieve_all();
+        assert(!buf.has_block());
+
+        // End of stream: no block kept either
+        close(fds[1]);
+        assert(buf.read_fd(fds[0]) == 0);
+        assert(!buf.has_block());
+    }
+    assert(BlockPool::instance().outstanding() == baseline);
+
+    close(fds[0]);
+    std::cout << "[Test] Buffer Lazy Block: Passed." << std::endl;
+}
+
+int main() {
+    test_cursors();
+    test_read_fd();
+    test_views();
+    test_lazy_block();
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "../include/compression.h"
+#include "../include/frame.h"
+
+static std::string round_trip(const std::string& data) {
+    std::vector<char> packed(lz4_compress_bound(data.size()));
+    size_t n = lz4_compress(data.data(), data.size(), packed.data(), packed.size());
+    assert(n > 0);
+    std::string out(data.size(), '\0');
+    assert(lz4_decompress(packed.data(), n, &out[0], out.size()));
+    // Any other expected size is an error, not a partial result
+    std::vector<char> wrong(data.size() + 1);
+    assert(!lz4_decompress(packed.data(), n, wrong.data(), wrong.size()));
+    return out;
+}
+
+void test_round_trip() {
+    std::cout << "[Test] LZ4 Round Trip: Starting..." << std::endl;
+
+    std::vector<std::string> inputs = {"", "a", "hello", "0123456789abc", std::string(100000, 'x')};
+    // Log-like text: repeats at every distance, long and short matches
+    std::string log;
+    for (int i = 0; log.size() < 300000; ++i) {
+        log += "2026-10-17 12:00:" + std::to_string(i % 60) + " [INFO] User logged in: user" +
+               std::to_string(i * 7 % 1000) + " (fd: " + std::to_string(i % 97) + ")\n";
+    }
+    inputs.push_back(log);
+    // Incompressible, then a literal run far beyond 15 + 255
+    std::string random(5000, '\0');
+    srand(7);
+    for (auto& c : random) c = (char)rand();
+    inputs.push_back(random);
+    inputs.push_back(random + std::string(3000, 'z') + random.substr(0, 2000));
+    // Matches that overlap their own output (offset < length)
+    inputs.push_back(std::string("ab") + std::string(1000, 'c') + "abababababababababababab");
+
+    for (const std::string& data : inputs) {
+        assert(round_trip(data) == data);
+    }
+
+    std::vector<char> packed(lz4_compress_bound(log.size()));
+    size_t n = lz4_compress(log.data(), log.size(), packed.data(), packed.size());
+    assert(n < log.size() / 4);
+    // Not enough room: nothing, rather than a truncated block
+    assert(lz4_compress(log.data(), log.size(), packed.data(), n - 1) == 0);
+
+    std::cout << "[Test] LZ4 Round Trip: Passed." << std::endl;
+}
+
+void test_reference_block() {
+    std::cout << "[Test] LZ4 Reference Block: Starting..." << std::endl;
+
+    // Hand-assembled per the format: "a" + 8-byte match at offset 1, then 5 literals
+    const unsigned char block[] = {0x14, 'a', 0x01, 0x00, 0x50, 'b', 'b', 'b', 'b', 'b'};
+    char out[14];
+    assert(lz4_decompress(block, sizeof(block), out, sizeof(out)));
+    assert(std::string(out, sizeof(out)) == "aaaaaaaaabbbbb");
+
+    // Truncated, offset before the start of the output, offset 0
+    assert(!lz4_decompress(block, sizeof(block) - 1, out, sizeof(out)));
+    const unsigned char far[] = {0x14, 'a', 0x02, 0x00, 0x50, 'b', 'b', 'b', 'b', 'b'};
+    assert(!lz4_decompress(far, sizeof(far), out, sizeof(out)));
+    const unsigned char zero[] = {0x14, 'a', 0x00, 0x00, 0x50, 'b', 'b', 'b', 'b', 'b'};
+    assert(!lz4_decompress(zero, sizeof(zero), out, sizeof(out)));
+    assert(!lz4_decompress(block, 0, out, 0));
+
+    std::cout << "[Test] LZ4 Reference Block: Passed." << std::endl;
+}
+
+void test_corrupt_input() {
+    std::cout << "[Test] LZ4 Corrupt Input: Starting..." << std::endl;
+
+    std::string text;
+    for (int i = 0; i < 2000; ++i) text += "{\"id\": " + std::to_string(i) + ", \"name\": \"file\"},";
+    std::vector<char> packed(lz4_compress_bound(text.size()));
+    size_t n = lz4_compress(text.data(), text.size(), packed.data(), packed.size());
+    packed.resize(n);
+
+    // Damaged blocks must fail or decode to something; never stray out of bounds
+    srand(3);
+    std::vector<char> out(text.size());
+    for (int round = 0; round < 2000; ++round) {
+        std::vector<char> damaged = packed;
+        for (int i = 0; i < 4; ++i) damaged[rand() % damaged.size()] = (char)rand();
+        size_t len = round % 2 ? damaged.size() : rand() % damaged.size();
+        lz4_decompress(damaged.data(), len, out.data(), out.size());
+    }
+
+    std::cout << "[Test] LZ4 Corrupt Input: Passed." << std::endl;
+}
+
+void test_frames() {
+    std::cout << "[Test] LZ4 Frames: Starting..." << std::endl;
+
+    CompressionStats before = compression_stats();
+    std::string chat = "[alice]: ";
+    for (int i = 0; i < 50; ++i) chat += "the build is green again, ";
+    FramePtr plain = make_frame(MSG_CHAT_PUBLIC, chat);
+    FramePtr packed = plain->compressed();
+    assert(packed && packed == plain->compressed());  // Built once, shared
+    assert(packed->header.msg_type == (MSG_CHAT_PUBLIC | FRAME_FLAG_LZ4));
+    assert(packed->size() < plain->size());
+    assert((uint32_t)packed->header.crc32 == crc32c(packed->payload.data(), packed->payload.size()));
+
+    std::vector<char> body;
+    assert(expand_frame_body(packed->header.msg_type, packed->payload.data(), packed->payload.size(), 1 << 20, body));
+    assert(std::string(body.begin(), body.end()) == chat);
+    assert(!expand_frame_body(packed->header.msg_type, packed->payload.data(), packed->payload.size(), 100, body));
+
+    // Nothing to gain: no variant
+    assert(!make_frame(MSG_CHAT_PUBLIC, "[bob]: hi")->compressed());
+
+    // File data: the chunk header stays readable in front
+    std::string data(10000, 'q');
+    FileChunkHeader chunk;
+    chunk.offset = 4096;
+    chunk.transfer_id = 9;
+    chunk.length = data.size();
+    std::string payload(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+    assert(compress_block(data.data(), data.size(), payload));
+    assert(expand_frame_body(MSG_FILE_DATA | FRAME_FLAG_LZ4, payload.data(), payload.size(), 1 << 20, body));
+    assert(body.size() == sizeof(chunk) + data.size());
+    assert(memcmp(body.data(), &chunk, sizeof(chunk)) == 0);
+    assert(std::string(body.begin() + sizeof(chunk), body.end()) == data);
+
+    CompressionStats after = compression_stats();
+    assert(after.blocks == before.blocks + 3);
+    assert(after.raw_bytes - before.raw_bytes == chat.size() + data.size());
+    assert(after.stored_bytes - before.stored_bytes == 9);
+
+    // The same frame with the LZ4 block referenced as a tail, not copied
+    auto block = std::make_shared<const std::string>(payload.substr(sizeof(chunk)));
+    FramePtr tailed = make_frame(MSG_FILE_DATA | FRAME_FLAG_LZ4, payload.substr(0, sizeof(chunk)), block);
+    assert(tailed->tail == block && tailed->size() == sizeof(PacketHeader) + payload.size());
+    assert((size_t)tailed->header.total_len == tailed->size());
+    assert((uint32_t)tailed->header.crc32 == crc32c(payload.data(), payload.size()));
+    assert(!tailed->compressed());
+
+    std::cout << "[Test] LZ4 Frames: Passed." << std::endl;
+}
+
+int main() {
+    test_round_trip();
+    test_reference_block();
+    test_corrupt_input();
+    test_frames();
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cstdlib>
+#include "../include/crc32c.h"
+
+void test_known_values() {
+    std::cout << "[Test] CRC32C Known Values: Starting..." << std::endl;
+
+    assert(crc32c("", 0) == 0);
+    assert(crc32c("123456789", 9) == 0xE3069283);
+    assert(crc32c_sw("123456789", 9) == 0xE3069283);
+    std::vector<char> zeros(32, 0);
+    assert(crc32c(zeros.data(), zeros.size()) == 0x8A9136AA);  // RFC 3720 B.4
+    std::vector<char> ones(32, (char)0xFF);
+    assert(crc32c(ones.data(), ones.size()) == 0x62A8AB43);
+
+    std::cout << "[Test] CRC32C Known Values: Passed." << std::endl;
+}
+
+void test_hw_matches_sw() {
+    std::cout << "[Test] CRC32C Hardware vs Tables: Starting..." << std::endl;
+
+    if (!crc32c_hw_available()) {
+        std::cout << "[Test] CRC32C Hardware vs Tables: Skipped (no SSE4.2)." << std::endl;
+        return;
+    }
+    std::vector<char> data(64 * 1024);
+    srand(42);
+    for (auto& c : data) c = (char)rand();
+    // Every alignment, lengths around the 3-stripe block boundaries
+    for (size_t len : {0, 1, 7, 8, 9, 63, 4096, 12287, 12288, 12289, 40000, 65000}) {
+        for (size_t align = 0; align < 8; ++align) {
+            assert(crc32c_hw(data.data() + align, len) == crc32c_sw(data.data() + align, len));
+            assert(crc32c_hw(data.data() + align, len, 0x12345678) ==
+                   crc32c_sw(data.data() + align, len, 0x12345678));
+        }
+    }
+
+    std::cout << "[Test] CRC32C Hardware vs Tables: Passed." << std::endl;
+}
+
+void test_continue_and_combine() {
+    std::cout << "[Test] CRC32C Continue/Combine: Starting..." << std::endl;
+
+    std::vector<char> data(100000);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (char)(i * 131 + 7);
+    uint32_t whole = crc32c(data.data(), data.size());
+    for (size_t split : {0, 1, 4096, 50000, 99999, 100000}) {
+        uint32_t a = crc32c(data.data(), split);
+        uint32_t b = crc32c(data.data() + split, data.size() - split);
+        assert(crc32c(data.data() + split, data.size() - split, a) == whole);
+        assert(crc32c_combine(a, b, data.size() - split) == whole);
+    }
+
+    std::cout << "[Test] CRC32C Continue/Combine: Passed." << std::endl;
+}
+
+void test_frame_verifier() {
+    std::cout << "[Test] FrameVerifier: Starting..." << std::endl;
+
+    const char body[] = "payload";
+    uint32_t good = crc32c(body, sizeof(body));
+    uint32_t bad = good ^ 1;
+
+    FrameVerifier off(CrcVerify::Off);
+    assert(off.check(bad, body, sizeof(body)));
+
+    FrameVerifier all(CrcVerify::All);
+    assert(all.check(good, body, sizeof(body)));
+    assert(!all.check(bad, body, sizeof(body)));
+    assert(all.check(0, body, sizeof(body)));  // No checksum sent
+
+    // Sample: the first checksummed frame of every kCrcSampleInterval
+    FrameVerifier sample(CrcVerify::Sample);
+    int caught = 0;
+    for (uint32_t i = 0; i < 4 * kCrcSampleInterval; ++i) {
+        if (!sample.check(bad, body, sizeof(body))) caught++;
+    }
+    assert(caught == 4);
+
+    sample.set_mode(CrcVerify::All);
+    assert(!sample.check(bad, body, sizeof(body)));
+
+    CrcVerify mode;
+    assert(crc_verify_from_name("sample", mode) && mode == CrcVerify::Sample);
+    assert(!crc_verify_from_name("some", mode));
+
+    std::cout << "[Test] FrameVerifier: Passed." << std::endl;
+}
+
+int main() {
+    test_known_values();
+    test_hw_matches_sw();
+    test_continue_and_combine();
+    test_frame_verifier();
+    return 0;
+}
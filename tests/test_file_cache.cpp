@@ -0,0 +1,189 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+#include <unistd.h>
+#include "../include/file_cache.h"
+#include "../include/crc32c.h"
+#include "../include/compression.h"
+
+static void write_file(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+void test_hits_and_content(const std::string& dir) {
+    std::cout << "[Test] FileCache Hits: Starting..." << std::endl;
+
+    write_file(dir + "/small", "hello");
+    write_file(dir + "/large", std::string(10000, 'x'));
+    FileCache cache(dir, 16, 1 << 20, 1024);
+    std::string error;
+
+    CachedFilePtr small = cache.acquire("small", error);
+    assert(small && small->size == 5);
+    assert(small->content && *small->content == "hello");
+    CachedFilePtr large = cache.acquire("large", error);
+    assert(large && large->size == 10000 && !large->content);  // Over the small-file limit
+    assert(!cache.acquire("missing", error) && !error.empty());
+
+    assert(cache.acquire("small", error) == small);  // Same open file
+    FileCache::Stats stats = cache.stats();
+    assert(stats.hits == 1 && stats.misses == 3);
+    assert(stats.entries == 2 && stats.memory_bytes == 5);
+
+    std::cout << "[Test] FileCache Hits: Passed." << std::endl;
+}
+
+void test_lru_eviction(const std::string& dir) {
+    std::cout << "[Test] FileCache LRU: Starting..." << std::endl;
+
+    write_file(dir + "/a", "a");
+    write_file(dir + "/b", "b");
+    write_file(dir + "/c", "c");
+    FileCache cache(dir, 2, 1 << 20, 1024);
+    std::string error;
+
+    CachedFilePtr a = cache.acquire("a", error);
+    cache.acquire("b", error);
+    cache.acquire("a", error);  // b is now least recently used
+    cache.acquire("c", error);  // evicts b
+    FileCache::Stats stats = cache.stats();
+    assert(stats.entries == 2 && stats.evictions == 1);
+    assert(cache.acquire("a", error) == a);
+    cache.acquire("b", error);
+    assert(cache.stats().misses == 4);
+
+    // An evicted file stays readable through the handle already given out
+    char byte;
+    assert(pread(a->fd, &byte, 1, 0) == 1 && byte == 'a');
+
+    std::cout << "[Test] FileCache LRU: Passed." << std::endl;
+}
+
+void test_invalidation(const std::string& dir) {
+    std::cout << "[Test] FileCache Invalidation: Starting..." << std::endl;
+
+    write_file(dir + "/doc", "v1");
+    FileCache cache(dir, 16, 1 << 20, 1024);
+    std::string error;
+    assert(*cache.acquire("doc", error)->content == "v1");
+
+    write_file(dir + "/doc", "version2");
+    if (cache.notify_fd() >= 0) {
+        cache.process_events();  // What loop 0 does when the fd turns readable
+        assert(cache.stats().invalidations == 1);
+    }
+    // Either way (inotify or stat fallback) the new content is served
+    CachedFilePtr doc = cache.acquire("doc", error);
+    assert(doc->size == 8 && *doc->content == "version2");
+
+    std::cout << "[Test] FileCache Invalidation: Passed." << std::endl;
+}
+
+void test_range_crc(const std::string& dir) {
+    std::cout << "[Test] FileCache Range CRC: Starting..." << std::endl;
+
+    // Three and a half checksum blocks
+    std::string content(CachedFile::kCrcBlock * 7 / 2, '\0');
+    for (size_t i = 0; i < content.size(); ++i) content[i] = (char)(i * 31 + i / 7);
+    write_file(dir + "/blocks", content);
+    FileCache cache(dir, 16, 1 << 20, 1024);
+    std::string error;
+    CachedFilePtr file = cache.acquire("blocks", error);
+    assert(file);
+
+    const size_t block = CachedFile::kCrcBlock;
+    struct { size_t offset, len; } ranges[] = {
+        {0, content.size()}, {0, block}, {block, 2 * block}, {100, 3 * block},
+        {3 * block, content.size() - 3 * block}, {block + 5, 10}, {content.size(), 0},
+    };
+    for (int pass = 0; pass < 2; ++pass) {  // Second pass uses the remembered blocks
+        for (const auto& r : ranges) {
+            uint32_t crc;
+            assert(file->range_crc(r.offset, r.len, crc));
+            assert(crc == crc32c(content.data() + r.offset, r.len));
+        }
+    }
+    uint32_t crc;
+    assert(!file->range_crc(content.size() - 1, 2, crc));  // Past the end
+
+    // The loops' form never reads whole blocks: nothing until they are warmed
+    write_file(dir + "/cold", content);
+    CachedFilePtr cold = cache.acquire("cold", error);
+    assert(cold);
+    assert(!cold->cached_range_crc(0, 2 * block, crc));
+    if (cold->cached_range_crc(block + 5, 10, crc)) {  // Unaligned piece: read if in the page cache
+        assert(crc == crc32c(content.data() + block + 5, 10));
+    }
+    cold->warm_crcs(block / 2, block);  // Blocks 0 and 1
+    assert(cold->cached_range_crc(0, 2 * block, crc));
+    assert(crc == crc32c(content.data(), 2 * block));
+    assert(!cold->cached_range_crc(0, 3 * block, crc));
+    cold->warm_crcs(0, content.size());
+    assert(cold->cached_range_crc(100, content.size() - 100, crc));
+    assert(crc == crc32c(content.data() + 100, content.size() - 100));
+
+    std::cout << "[Test] FileCache Range CRC: Passed." << std::endl;
+}
+
+void test_compressed_ranges(const std::string& dir) {
+    std::cout << "[Test] FileCache Compressed Ranges: Starting..." << std::endl;
+
+    std::string text;
+    while (text.size() < 300000) text += "level=info msg=\"chunk sent\" bytes=131072\n";
+    std::string noise(4096, '\0');
+    srand(11);
+    for (auto& c : noise) c = (char)rand();
+    write_file(dir + "/log", text);
+    write_file(dir + "/noise", noise);
+    FileCache cache(dir, 16, 1 << 20, 1024, 1 << 20);
+    std::string error;
+    CachedFilePtr log = cache.acquire("log", error);
+    CachedFilePtr random = cache.acquire("noise", error);
+    assert(log && random);
+
+    std::shared_ptr<const std::string> found;
+    assert(!cache.cached_compressed_range(log, 131072, 131072, found));  // Lookup only: not compressed
+    auto packed = cache.compressed_range(log, 131072, 131072);
+    assert(packed && packed->size() < 131072 / 20);
+    assert(cache.cached_compressed_range(log, 131072, 131072, found) && found == packed);
+    std::string out(131072, '\0');
+    assert(lz4_decompress(packed->data(), packed->size(), &out[0], out.size()));
+    assert(out == text.substr(131072, 131072));
+    assert(cache.compressed_range(log, 131072, 131072) == packed);  // Kept, not recompressed
+
+    assert(!cache.compressed_range(random, 0, noise.size()));  // Does not shrink
+    assert(!cache.compressed_range(random, 0, noise.size()));
+    assert(cache.cached_compressed_range(random, 0, noise.size(), found) && !found);  // Known not to shrink
+    assert(!cache.compressed_range(log, text.size() - 10, 11));  // Past the end
+
+    FileCache::Stats stats = cache.stats();
+    assert(stats.compressed_hits == 4 && stats.compressed_misses == 2);
+
+    // Room for one such range: the least recently used one goes
+    FileCache small(dir, 16, 1 << 20, 1024, (packed->size() + 128) * 3 / 2);
+    log = small.acquire("log", error);
+    auto first = small.compressed_range(log, 131072, 131072);
+    assert(small.compressed_range(log, 131072, 131072) == first);
+    small.compressed_range(log, 0, 131072);
+    assert(small.stats().compressed_bytes <= (packed->size() + 128) * 3 / 2);
+    assert(small.compressed_range(log, 131072, 131072) != first);
+
+    std::cout << "[Test] FileCache Compressed Ranges: Passed." << std::endl;
+}
+
+int main() {
+    char dir_template[] = "/tmp/file_cache_test_XXXXXX";
+    std::string dir = mkdtemp(dir_template);
+
+    test_hits_and_content(dir);
+    test_lru_eviction(dir);
+    test_invalidation(dir);
+    test_range_crc(dir);
+    test_compressed_ranges(dir);
+
+    std::string cleanup = "rm -rf " + dir;
+    return system(cleanup.c_str());
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <cassert>
+#include <cstdint>
+#include "../include/histogram.h"
+
+void test_buckets() {
+    std::cout << "[Test] Histogram Buckets: Starting..." << std::endl;
+
+    // Exact below 2 * kSubBuckets, then contiguous and within 1/kSubBuckets
+    for (uint64_t v = 0; v < 2 * Histogram::kSubBuckets; ++v) {
+        assert(Histogram::index_of(v) == v && Histogram::highest_in(v) == v);
+    }
+    size_t last = Histogram::index_of(2 * Histogram::kSubBuckets - 1);
+    for (uint64_t v = 2 * Histogram::kSubBuckets; v < (1u << 30); v += 1 + v / 128) {  // Below one bucket width
+        size_t index = Histogram::index_of(v);
+        assert(index == last || index == last + 1);
+        assert(Histogram::highest_in(index) >= v);
+        assert(Histogram::highest_in(index) - v <= v / Histogram::kSubBuckets);
+        last = index;
+    }
+    assert(Histogram::index_of(UINT64_MAX) == Histogram::kBuckets - 1);
+    assert(Histogram::highest_in(Histogram::kBuckets - 1) == UINT64_MAX);
+
+    std::cout << "[Test] Histogram Buckets: Passed." << std::endl;
+}
+
+void test_percentiles() {
+    std::cout << "[Test] Histogram Percentiles: Starting..." << std::endl;
+
+    Histogram h;
+    assert(h.percentile(0.5) == 0 && h.count() == 0);
+    for (uint64_t v = 1; v <= 100000; ++v) h.record(v * 1000);  // 1 us .. 100 ms
+    assert(h.count() == 100000 && h.max() == 100000000);
+
+    double expected[][2] = {{0.5, 50e6}, {0.99, 99e6}, {0.999, 99.9e6}};
+    for (auto& e : expected) {
+        double got = (double)h.percentile(e[0]);
+        assert(got >= e[1] && got <= e[1] * (1 + 1.0 / Histogram::kSubBuckets));
+    }
+    assert(h.percentile(1.0) == h.max());
+    assert(h.percentile(0) <= 1000 * (1 + 1.0 / Histogram::kSubBuckets));
+
+    Histogram other;
+    other.record(500000000);
+    h.merge(other);
+    assert(h.count() == 100001 && h.max() == 500000000);
+    h.reset();
+    assert(h.count() == 0 && h.max() == 0);
+
+    std::cout << "[Test] Histogram Percentiles: Passed." << std::endl;
+}
+
+void test_concurrent_record() {
+    std::cout << "[Test] Histogram Concurrent Record: Starting..." << std::endl;
+
+    Histogram h;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&h, t] {
+            for (uint64_t i = 0; i < 100000; ++i) h.record(i % 1000 + t);
+        });
+    }
+    for (auto& t : threads) t.join();
+    assert(h.count() == 400000);
+    assert(h.max() == 999 + 3);
+
+    std::cout << "[Test] Histogram Concurrent Record: Passed." << std::endl;
+}
+
+int main() {
+    test_buckets();
+    test_percentiles();
+    test_concurrent_record();
+    return 0;
+}
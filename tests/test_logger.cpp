@@ -0,0 +1,62 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+#include "../include/logger.h"
+
+static int evaluated = 0;
+static std::string counted(const std::string& text) {
+    evaluated++;
+    return text;
+}
+
+void test_logger() {
+    std::cout << "[Test] Logger: Starting..." << std::endl;
+
+    char path[] = "/tmp/logger_test_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(Logger::instance().set_output(path));
+
+    Logger::set_level(WARNING);
+    LOG_INFO(counted("filtered"));         // Below the runtime level: message not even built
+    LOG_DEBUG(counted("compiled out"));
+    LOG_WARNING(counted("kept warning"));
+    Logger::set_level(INFO);
+    assert(evaluated == 1);
+
+    const int total = 20000;
+    for (int i = 0; i < total; ++i) {
+        LOG_INFO("line " + std::to_string(i));
+    }
+    LOG_ERROR("last");
+    Logger::instance().flush();
+
+    std::ifstream in(path);
+    std::string line;
+    int lines = 0, warnings = 0;
+    bool saw_last = false;
+    while (std::getline(in, line)) {
+        assert(line.size() > 22 && line[0] == '[' && line[20] == ']');  // [YYYY-mm-dd HH:MM:SS]
+        if (line.find("[INFO] line ") != std::string::npos) lines++;
+        if (line.find("Logger dropped") != std::string::npos) warnings++;
+        if (line.find("kept warning") != std::string::npos) assert(line.find("[WARNING]") != std::string::npos);
+        if (line.find("[ERROR] last") != std::string::npos) saw_last = true;
+        assert(line.find("filtered") == std::string::npos);
+    }
+    // Overflow drops lines instead of blocking, and says so
+    assert((uint64_t)lines + saw_last + Logger::instance().dropped() == (uint64_t)total + 1);
+    assert(Logger::instance().dropped() == 0 || warnings > 0);
+    unlink(path);
+
+    std::cout << "[Test] Logger: Passed. Written " << lines << ", dropped "
+              << Logger::instance().dropped() << std::endl;
+}
+
+int main() {
+    test_logger();
+    return 0;
+}
@@ -2,16 +2,16 @@
 #include <vector>
 #include <cstring>
 #include <cassert>
+#include <string>
 #include "../include/protocol.h"
+#include "../include/buffer.h"
 
-// Manual mock of the parsing logic found in network_epoll.cpp
-// In a real scenario, parsing logic should be in a separate class (e.g. ProtocolParser).
-// Here we replicate the logic to verify correctness.
+// Drives next_packet(), the framing every reactor runs on its read buffer
 
 void test_packet_parsing() {
     std::cout << "[Test] Protocol Parsing: Starting..." << std::endl;
 
-    std::vector<char> read_buffer;
+    Buffer read_buffer;
 
     // 1. Create a dummy login packet
     PacketHeader hdr;
@@ -19,6 +19,7 @@ void test_packet_parsing() {
     hdr.crc32 = 0;
     
     LoginBody body;
+    memset(&body, 0, sizeof(body));
     strcpy(body.username, "TestUser");
     
     hdr.total_len = sizeof(PacketHeader) + sizeof(LoginBody);
@@ -29,36 +30,129 @@ void test_packet_parsing() {
     memcpy(packet.data() + sizeof(PacketHeader), &body, sizeof(LoginBody));
 
     // 3. Simulate Sticky Packet: Push 1 full packet + 0.5 packet
-    read_buffer.insert(read_buffer.end(), packet.begin(), packet.end());
-    read_buffer.insert(read_buffer.end(), packet.begin(), packet.begin() + sizeof(PacketHeader)); // Partial
+    read_buffer.append(packet.data(), packet.size());
+    read_buffer.append(packet.data(), sizeof(PacketHeader)); // Partial
 
     // 4. Test Extraction
-    // Check Header
-    assert(read_buffer.size() >= sizeof(PacketHeader));
     PacketHeader extracted_hdr;
-    memcpy(&extracted_hdr, read_buffer.data(), sizeof(PacketHeader));
-    
+    PacketView extracted_body;
+    assert(next_packet(read_buffer, extracted_hdr, extracted_body) == FrameStatus::Complete);
     assert(extracted_hdr.msg_type == MSG_LOGIN);
     assert(extracted_hdr.total_len == hdr.total_len);
+    assert(extracted_body.size() == sizeof(LoginBody));
+    assert(strcmp(extracted_body.as<LoginBody>()->username, "TestUser") == 0);
 
-    // Check Body availability
-    assert((int)read_buffer.size() >= extracted_hdr.total_len);
-    
-    // "Process" it (Remove from buffer)
-    read_buffer.erase(read_buffer.begin(), read_buffer.begin() + extracted_hdr.total_len);
-
-    // 5. Verify remaining data is incomplete (the 0.5 packet)
-    if (read_buffer.size() >= sizeof(PacketHeader)) {
-         PacketHeader partial_hdr;
-         memcpy(&partial_hdr, read_buffer.data(), sizeof(PacketHeader));
-         // Should fail check for full body
-         assert((int)read_buffer.size() < partial_hdr.total_len);
+    // 5. The 0.5 packet stays buffered until the rest arrives, a byte at a time
+    assert(next_packet(read_buffer, extracted_hdr, extracted_body) == FrameStatus::NeedMore);
+    assert(read_buffer.readable() == sizeof(PacketHeader));
+    for (size_t i = sizeof(PacketHeader); i < packet.size(); ++i) {
+        assert(next_packet(read_buffer, extracted_hdr, extracted_body) == FrameStatus::NeedMore);
+        read_buffer.append(packet.data() + i, 1);
     }
+    assert(next_packet(read_buffer, extracted_hdr, extracted_body) == FrameStatus::Complete);
+    assert(read_buffer.readable() == 0);
+
+    // 6. Lengths that cannot be a frame
+    hdr.total_len = sizeof(PacketHeader) - 1;
+    read_buffer.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    assert(next_packet(read_buffer, extracted_hdr, extracted_body) == FrameStatus::Invalid);
+    read_buffer.retrieve_all();
+    hdr.total_len = kMaxPacketLen + 1;
+    read_buffer.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    assert(next_packet(read_buffer, extracted_hdr, extracted_body) == FrameStatus::Invalid);
 
     std::cout << "[Test] Protocol Parsing: Passed." << std::endl;
 }
 
+void test_file_frame_layout() {
+    std::cout << "[Test] File Frame Layout: Starting..." << std::endl;
+
+    // Wire structs must not contain padding: client and server memcpy them
+    assert(sizeof(FileRangeReqBody) == 256 + 8 + 8);
+    assert(sizeof(FileStartBody) == 8 + 8 + 8 + 4 + 4 + 256);
+    assert(sizeof(FileChunkHeader) == 16);
+    assert(sizeof(FileEndBody) == 16);
+
+    // A chunk of a >4GB file: offset survives the round trip, frame stays small
+    FileChunkHeader chunk;
+    chunk.offset = 5ull * 1024 * 1024 * 1024;
+    chunk.transfer_id = 7;
+    chunk.length = 128 * 1024;
+    PacketHeader hdr;
+    hdr.msg_type = MSG_FILE_DATA;
+    hdr.crc32 = 0;
+    hdr.total_len = sizeof(PacketHeader) + sizeof(FileChunkHeader) + chunk.length;
+
+    std::vector<char> packet(sizeof(PacketHeader) + sizeof(FileChunkHeader));
+    memcpy(packet.data(), &hdr, sizeof(hdr));
+    memcpy(packet.data() + sizeof(hdr), &chunk, sizeof(chunk));
+
+    FileChunkHeader parsed;
+    memcpy(&parsed, packet.data() + sizeof(PacketHeader), sizeof(parsed));
+    assert(parsed.offset == chunk.offset);
+    assert(parsed.transfer_id == 7);
+    assert(parsed.length == chunk.length);
+
+    std::cout << "[Test] File Frame Layout: Passed." << std::endl;
+}
+
+void test_compact_bodies() {
+    std::cout << "[Test] Compact Bodies: Starting..." << std::endl;
+
+    // Flags ride above the MsgType
+    int32_t type = MSG_CHAT_PUBLIC | FRAME_FLAG_COMPACT;
+    assert((type & kMsgTypeMask) == MSG_CHAT_PUBLIC);
+    assert(type & FRAME_FLAG_COMPACT);
+
+    // Public "hi": two empty-or-short fields, no padding
+    std::string body;
+    compact_put(body, "");
+    compact_put(body, "hi");
+    assert(body.size() == 4);
+    assert(body.size() * 250 < sizeof(ChatBody));
+
+    std::string_view target, content;
+    CompactReader reader(body.data(), body.size());
+    assert(reader.field(target) && target.empty());
+    assert(reader.field(content) && content == "hi");
+    assert(content.data() == body.data() + 2);  // A view, not a copy
+    assert(reader.remaining() == 0);
+
+    // Longer than v1 could carry: multi-byte length prefix
+    std::string long_text(5000, 'x');
+    body.clear();
+    compact_put(body, "bob");
+    compact_put(body, long_text);
+    assert(body.size() == 1 + 3 + 2 + 5000);
+    reader = CompactReader(body.data(), body.size());
+    assert(reader.field(target) && target == "bob");
+    assert(reader.field(content) && content == long_text);
+
+    // Truncated or oversized lengths are rejected, never read past the end
+    CompactReader cut(body.data(), body.size() - 1);
+    assert(cut.field(target));
+    assert(!cut.field(content));
+    const char bogus[] = {'\xff', '\xff', '\xff', '\xff', '\xff', '\x01'};
+    CompactReader overflow(bogus, sizeof(bogus));
+    assert(!overflow.field(content));
+
+    // Login: username, then optional features
+    body.clear();
+    compact_put(body, "alice");
+    uint32_t features = FEATURE_COMPACT_BODIES;
+    body.append(reinterpret_cast<const char*>(&features), sizeof(features));
+    reader = CompactReader(body.data(), body.size());
+    uint32_t parsed = 0;
+    assert(reader.field(target) && target == "alice");
+    assert(reader.u32(parsed) && parsed == FEATURE_COMPACT_BODIES);
+    assert(!reader.u32(parsed));
+
+    std::cout << "[Test] Compact Bodies: Passed." << std::endl;
+}
+
 int main() {
     test_packet_parsing();
+    test_file_frame_layout();
+    test_compact_bodies();
     return 0;
 }
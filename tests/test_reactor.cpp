@@ -0,0 +1,116 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "../include/reactor.h"
+#include "../include/uring.h"
+
+// Runs a real EpollServer on a loopback port and talks to it with plain
+// blocking sockets.
+
+static int free_port() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (struct sockaddr*)&addr, &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+static int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    struct timeval timeout = {5, 0};  // A lost frame fails the test instead of hanging it
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static void send_login(int fd, const std::string& name) {
+    struct {
+        PacketHeader header;
+        LoginBody body;
+    } __attribute__((packed)) packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.header.total_len = sizeof(packet);
+    packet.header.msg_type = MSG_LOGIN;
+    strncpy(packet.body.username, name.c_str(), sizeof(packet.body.username) - 1);
+    assert(write(fd, &packet, sizeof(packet)) == (ssize_t)sizeof(packet));
+}
+
+static bool read_all(int fd, void* data, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, static_cast<char*>(data) + got, len - got);
+        if (n <= 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+// Next frame's type and body; false on EOF
+static bool read_frame(int fd, int32_t& type, std::string& body) {
+    PacketHeader header;
+    if (!read_all(fd, &header, sizeof(header))) return false;
+    body.assign(header.total_len - sizeof(header), '\0');
+    if (!read_all(fd, &body[0], body.size())) return false;
+    type = header.msg_type & kMsgTypeMask;
+    return true;
+}
+
+void test_kick_notice(EventBackend backend, const char* name) {
+    std::cout << "[Test] Kick Notice (" << name << ", coalescing): Starting..." << std::endl;
+
+    ThreadPool pool(2);
+    ServerConfig config;
+    config.write_coalescing = true;
+    config.event_backend = backend;
+    config.duplicate_login_policy = DuplicateLoginPolicy::KickOld;
+    config.stats = false;
+    int port = free_port();
+    EpollServer server(&pool, config);
+    server.init(port, "127.0.0.1");
+    std::thread loop([&server]() { server.run(); });
+
+    int32_t type;
+    std::string body;
+    int first = connect_to(port);
+    send_login(first, "alice");
+    assert(read_frame(first, type, body) && type == MSG_LOGIN_ACK);
+
+    // The displaced session gets the notice before its connection closes
+    int second = connect_to(port);
+    send_login(second, "alice");
+    assert(read_frame(second, type, body) && type == MSG_LOGIN_ACK);
+    assert(read_frame(first, type, body) && type == MSG_ERROR);
+    assert(body == "Logged in from another connection");
+    assert(!read_frame(first, type, body));  // Then EOF
+
+    close(first);
+    close(second);
+    server.stop();
+    loop.join();
+
+    std::cout << "[Test] Kick Notice (" << name << ", coalescing): Passed." << std::endl;
+}
+
+int main() {
+    Logger::set_level(WARNING);
+    test_kick_notice(EventBackend::Epoll, "epoll");
+    if (Uring::supported()) test_kick_notice(EventBackend::IoUring, "io_uring");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cassert>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/server_stats.h"
+#include "../include/admin_server.h"
+
+void test_shards_merge() {
+    std::cout << "[Test] ServerStats Shards: Starting..." << std::endl;
+
+    ServerStats stats;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&stats, t] {
+            for (int i = 0; i < 1000; ++i) {
+                stats.record(STAGE_HANDLER, 1000 * (t + 1));
+                stats.count_in(MSG_CHAT_PUBLIC | FRAME_FLAG_COMPACT, 100);  // Flags do not split the type
+                stats.count_out(MSG_CHAT_PUBLIC, 10);
+            }
+            ServerStats::bump(stats.local().accepted);
+        });
+    }
+    for (auto& t : threads) t.join();
+    stats.count_in(0x1234, 7);  // Beyond the table: counted as type 0
+    stats.record(STAGE_WRITE, -5);  // Clock skew never wraps around
+
+    std::unique_ptr<ServerStats::Snapshot> snap(new ServerStats::Snapshot);
+    stats.snapshot(*snap);
+    assert(snap->stages[STAGE_HANDLER].count() == 8000);
+    assert(snap->stages[STAGE_HANDLER].max() == 8000);
+    assert(snap->stages[STAGE_QUEUE_WAIT].count() == 0);
+    assert(snap->stages[STAGE_WRITE].count() == 1 && snap->stages[STAGE_WRITE].max() == 0);
+    assert(snap->packets_in[MSG_CHAT_PUBLIC] == 8000 && snap->bytes_in[MSG_CHAT_PUBLIC] == 800000);
+    assert(snap->packets_out[MSG_CHAT_PUBLIC] == 8000 && snap->bytes_out[MSG_CHAT_PUBLIC] == 80000);
+    assert(snap->packets_in[0] == 1 && snap->bytes_in[0] == 7);
+    assert(snap->accepted == 8);
+
+    stats.reset();
+    stats.snapshot(*snap);
+    assert(snap->stages[STAGE_HANDLER].count() == 0);
+    assert(snap->packets_in[MSG_CHAT_PUBLIC] == 0 && snap->accepted == 0);
+
+    assert(msg_type_name(MSG_CHAT_PRIVATE) == "CHAT_PRIVATE");
+    assert(msg_type_name(0x42) == "66");
+
+    std::cout << "[Test] ServerStats Shards: Passed." << std::endl;
+}
+
+static std::string ask(const std::string& path, const std::string& command) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    assert(write(fd, command.data(), command.size()) == (ssize_t)command.size());
+    shutdown(fd, SHUT_WR);
+    std::string reply;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) reply.append(buf, n);
+    close(fd);
+    return reply;
+}
+
+void test_admin_socket() {
+    std::cout << "[Test] Admin Socket: Starting..." << std::endl;
+
+    std::string path = "/tmp/test_admin_" + std::to_string(getpid()) + ".sock";
+    struct stat st;
+    {
+        AdminServer admin(path, [](const std::string& command) { return "got [" + command + "]\n"; });
+        assert(admin.start());
+        assert(ask(path, "stats\n") == "got [stats]\n");
+        assert(ask(path, "reset\r\n") == "got [reset]\n");
+        assert(ask(path, "") == "got []\n");  // EOF without a newline
+
+        // Another server cannot take over a live socket
+        AdminServer second(path, [](const std::string&) { return std::string(); });
+        assert(!second.start());
+        assert(ask(path, "help\n") == "got [help]\n");
+    }
+    assert(stat(path.c_str(), &st) != 0);  // Removed on shutdown
+
+    std::cout << "[Test] Admin Socket: Passed." << std::endl;
+}
+
+int main() {
+    test_shards_merge();
+    test_admin_socket();
+    return 0;
+}
@@ -2,7 +2,10 @@
 #include <vector>
 #include <atomic>
 #include <cassert>
+#include <mutex>
+#include <thread>
 #include "../include/threadpool.h"
+#include "../include/serial_executor.h"
 
 void test_threadpool() {
     std::cout << "[Test] ThreadPool: Starting..." << std::endl;
@@ -29,7 +32,148 @@ void test_threadpool() {
     std::cout << "[Test] ThreadPool: Passed. Counter = " << counter << std::endl;
 }
 
+void test_threadpool_overflow_and_nested() {
+    std::cout << "[Test] ThreadPool Overflow/Nested: Starting..." << std::endl;
+
+    std::atomic<int> counter(0);
+    {
+        ThreadPool pool(2);
+        // More tasks than the per-worker rings hold, each spawning a child
+        // from inside the pool (lands on the worker's own queue)
+        int num_tasks = 20000;
+        for (int i = 0; i < num_tasks; ++i) {
+            pool.enqueue([&counter, &pool] {
+                counter++;
+                pool.enqueue([&counter] { counter++; });
+            });
+        }
+        while (counter < 2 * num_tasks) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    assert(counter == 40000);
+    std::cout << "[Test] ThreadPool Overflow/Nested: Passed." << std::endl;
+}
+
+void test_threadpool_post() {
+    std::cout << "[Test] ThreadPool Post: Starting..." << std::endl;
+
+    std::atomic<int> counter(0);
+    auto tracker = std::make_shared<int>(0);
+    {
+        ThreadPool pool(2);
+        // Captured state must be released once the task has run, and a
+        // throwing task must not take its worker down
+        for (int i = 0; i < 1000; ++i) {
+            pool.post([&counter, tracker] { counter++; });
+        }
+        pool.post([] { throw std::runtime_error("ignored"); });
+        for (int i = 0; i < 1000; ++i) {
+            pool.post([&counter] { counter++; });
+        }
+        while (counter < 2000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    assert(counter == 2000);
+    assert(tracker.use_count() == 1);
+    std::cout << "[Test] ThreadPool Post: Passed." << std::endl;
+}
+
+void test_serial_executor_throw() {
+    std::cout << "[Test] SerialExecutor Throw: Starting..." << std::endl;
+
+    ThreadPool pool(2);
+    auto strand = std::make_shared<SerialExecutor>(&pool);
+    std::atomic<int> counter(0);
+    // A throwing task must not stall the strand: the ones queued behind it
+    // run, and so do later posts once the strand went idle
+    strand->post([&counter] { counter++; });
+    strand->post([] { throw std::runtime_error("ignored"); });
+    strand->post([&counter] { counter++; });
+    for (int i = 0; i < 1000 && counter < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(counter == 2);
+    strand->post([] { throw std::runtime_error("ignored"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    strand->post([&counter] { counter++; });
+    for (int i = 0; i < 1000 && counter < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    assert(counter == 3);
+    std::cout << "[Test] SerialExecutor Throw: Passed." << std::endl;
+}
+
+void test_serial_executor_order() {
+    std::cout << "[Test] SerialExecutor Order: Starting..." << std::endl;
+
+    const int kStrands = 4;
+    const int kProducers = 3;
+    const int kPerProducer = 200;  // Per strand: far more than kBatch in its ring
+    struct Strand {
+        std::shared_ptr<SerialExecutor> executor;
+        std::mutex post_mutex;      // Makes the ticket order the post order
+        int next_ticket = 0;
+        int expected = 0;           // Next ticket to run; touched by its tasks only
+        std::atomic<bool> in_flight{false};
+        std::atomic<int> ran{0};
+    };
+    ThreadPool pool(4);
+    std::vector<Strand> strands(kStrands);
+    std::atomic<bool> go(false);
+    std::atomic<int> misordered(0), overlapped(0);
+    for (auto& strand : strands) {
+        strand.executor = std::make_shared<SerialExecutor>(&pool);
+        // Holds each strand until every task is queued, so every turn but the
+        // last ends with a full kBatch and a re-post
+        strand.executor->post([&go] {
+            while (!go) std::this_thread::yield();
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kPerProducer; ++i) {
+                Strand& strand = strands[(i + p) % kStrands];
+                std::lock_guard<std::mutex> lock(strand.post_mutex);
+                int ticket = strand.next_ticket++;
+                strand.executor->post([&strand, &misordered, &overlapped, ticket] {
+                    if (strand.in_flight.exchange(true)) overlapped++;
+                    if (ticket != strand.expected++) misordered++;
+                    if (ticket % 7 == 0) std::this_thread::yield();  // Widen the window for an overlap
+                    strand.in_flight = false;
+                    strand.ran++;
+                });
+            }
+        });
+    }
+    for (auto& t : producers) t.join();
+    go = true;
+
+    int total = 0;
+    for (auto& strand : strands) {
+        assert(strand.next_ticket > 2 * SerialExecutor::kBatch);
+        total += strand.next_ticket;
+        for (int i = 0; i < 2000 && strand.ran < strand.next_ticket; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        assert(strand.ran == strand.next_ticket);
+    }
+    assert(total == kProducers * kPerProducer);
+    assert(misordered == 0 && overlapped == 0);
+    std::cout << "[Test] SerialExecutor Order: Passed." << std::endl;
+}
+
 int main() {
     test_threadpool();
+    test_threadpool_overflow_and_nested();
+    test_threadpool_post();
+    test_serial_executor_throw();
+    test_serial_executor_order();
     return 0;
 }
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include "../include/timing_wheel.h"
+
+void test_timing_wheel() {
+    std::cout << "[Test] TimingWheel: Starting..." << std::endl;
+
+    TimingWheel<int> wheel;
+    std::vector<std::pair<uint64_t, int>> fired;
+    auto record = [&](int value) { fired.push_back({wheel.now(), value}); };
+
+    // One entry per level, plus one in the past
+    wheel.schedule(3, 1);
+    wheel.schedule(100, 2);      // level 1
+    wheel.schedule(5000, 3);     // level 2
+    wheel.schedule(300000, 4);   // level 3
+    wheel.schedule(0, 5);        // past: fires on the next tick
+    assert(wheel.size() == 5);
+
+    wheel.advance(1, record);
+    assert(fired.size() == 1 && fired[0].first == 1 && fired[0].second == 5);
+
+    wheel.advance(300000, record);
+    assert(fired.size() == 5);
+    assert(fired[1].first == 3 && fired[1].second == 1);
+    assert(fired[2].first == 100 && fired[2].second == 2);
+    assert(fired[3].first == 5000 && fired[3].second == 3);
+    assert(fired[4].first == 300000 && fired[4].second == 4);
+    assert(wheel.size() == 0);
+
+    // Re-bucketing from the callback (what the idle check does on heartbeat)
+    fired.clear();
+    int reschedules = 0;
+    wheel.schedule(wheel.now() + 10, 7);
+    wheel.advance(100, [&](int value) {
+        fired.push_back({wheel.now(), value});
+        if (reschedules++ < 2) wheel.schedule(wheel.now() + 30, value);
+    });
+    assert(fired.size() == 3);
+    assert(fired[1].first - fired[0].first == 30);
+    assert(fired[2].first - fired[1].first == 30);
+
+    std::cout << "[Test] TimingWheel: Passed." << std::endl;
+}
+
+int main() {
+    test_timing_wheel();
+    return 0;
+}
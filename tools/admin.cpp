@@ -0,0 +1,83 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Client of the server's admin socket (--admin-socket). Sends one command
+// and prints the answer; with --interval it polls, redrawing the screen, so
+// the server's stats can be watched live.
+//
+//   ./bin/server --admin-socket=/tmp/im-admin.sock &
+//   ./bin/admin /tmp/im-admin.sock                 # stats once
+//   ./bin/admin /tmp/im-admin.sock --interval=2    # every 2 s, until Ctrl-C
+//   ./bin/admin /tmp/im-admin.sock reset
+
+static bool query(const std::string& path, const std::string& command, std::string& reply) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        reply = "Socket path too long: " + path;
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        reply = "Cannot connect to " + path + ": " + strerror(errno);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    std::string line = command + "\n";
+    if (write(fd, line.data(), line.size()) != (ssize_t)line.size()) {
+        reply = "Write to " + path + " failed: " + strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    reply.clear();
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) reply.append(buf, n);
+    close(fd);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path;
+    std::string command = "stats";
+    double interval = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--interval=", 0) == 0) {
+            interval = atof(arg.c_str() + strlen("--interval="));
+        } else if (path.empty()) {
+            path = arg;
+        } else {
+            command = arg;
+        }
+    }
+    if (path.empty() || interval < 0) {
+        std::cerr << "Usage: " << argv[0] << " <admin socket> [stats|reset|help] [--interval=seconds]" << std::endl;
+        return 1;
+    }
+
+    std::string reply;
+    if (interval == 0) {
+        bool ok = query(path, command, reply);
+        (ok ? std::cout : std::cerr) << reply << (ok ? "" : "\n");
+        return ok ? 0 : 1;
+    }
+    for (;;) {
+        bool ok = query(path, command, reply);
+        // Home + clear, then the new report
+        std::cout << "\033[H\033[2J" << path << " (every " << interval << " s)\n\n" << reply << std::flush;
+        if (!ok) std::cout << std::endl;
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+    }
+}